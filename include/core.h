@@ -24,6 +24,9 @@ typedef enum { DARK, LIGHT } COLOR_MODE;
 
 typedef enum { NONE, LIGHTEN, DARKEN } SHADE_MODE;
 
+// Color space process_colors works in
+typedef enum { ENGINE_HSV, ENGINE_OKLCH } COLOR_ENGINE;
+
 typedef struct {
   char *wallpaper;
   Color colors[PALETTE_MAX_SIZE];
@@ -32,4 +35,24 @@ typedef struct {
   float alpha;
   SHADE_MODE cols16_mode;
   COLOR_MODE mode;
+  COLOR_ENGINE engine;
 } Palette;
+
+// Resource limits for a Lua backend run. A value of 0 disables the limit; in
+// per-backend overrides a negative value inherits the [lua] default.
+typedef struct {
+  char *backend;         // NULL for the [lua] defaults
+  long max_instructions; // VM instructions per run
+  long timeout_ms;       // Wall-clock time per run
+  long max_memory_kb;    // Memory allocated during a run
+  int jit;               // Keep the JIT compiler on while limits are active
+} LuaLimits;
+
+// Caps on the palette cache; 0 disables a cap.
+typedef struct {
+  long max_entries; // Cached palettes
+  long max_size_kb; // Palette store size once compacted
+} CacheLimits;
+
+// Where computed raw palettes are written back next to their image
+typedef enum { SIDECAR_NONE, SIDECAR_XATTR, SIDECAR_FILE } SIDECAR_MODE;
@@ -68,6 +68,7 @@ end
 
 complete -c cwal -s m -l mode -d "Set theme mode (required: <dark|light>)" -r -xa "dark light"
 complete -c cwal -s c -l cols16-mode -d "Set 16-color mode (required: <darken|lighten>)" -r -xa "darken lighten"
+complete -c cwal -s e -l engine -d "Set color space (required: <hsv|oklch>)" -r -xa "hsv oklch"
 complete -c cwal -s s -l saturation -d "Overall saturation (required: <float>)" -r
 complete -c cwal -s C -l contrast -d "Contrast ratio (required: <float>)" -r
 complete -c cwal -s a -l alpha -d "Alpha transparency (required: <float>)" -r
@@ -82,6 +83,8 @@ complete -c cwal -s B -l list-backends -d "List available backends"
 complete -c cwal -s T -l list-themes -d "List available themes"
 complete -c cwal -s q -l quiet -d "Suppress all output"
 complete -c cwal -s N -l skip-cursor -d "Skip writing cursor color sequence"
+complete -c cwal -s G -l cache-gc -d "Evict old cached palettes and compact the cache"
+complete -c cwal -s W -l warm -d "Cache palettes for a directory (optional: [directory])" -xa "(__fish_complete_directories)"
 complete -c cwal -s p -l preview -d "Preview palette"
 complete -c cwal -s v -l version -d "Show version"
 complete -c cwal -s h -l help -d "Display help"
@@ -24,6 +24,9 @@ void print_usage(const char *prog_name) {
   fprintf(stderr, "  " YELLOW "-c, --cols16-mode" RESET " " CYAN
                   "<darken|lighten>" RESET
                   " Set 16-color generation mode (overrides config)\n");
+  fprintf(stderr, "  " YELLOW "-e, --engine" RESET " " CYAN "<hsv|oklch>" RESET
+                  "   Set color space for post-processing (overrides "
+                  "config)\n");
   fprintf(stderr, "  " YELLOW "-s, --saturation" RESET " " CYAN "<float>" RESET
                   "   Set overall saturation (overrides config)\n");
   fprintf(stderr, "  " YELLOW "-C, --contrast" RESET " " CYAN "<float>" RESET
@@ -62,6 +65,10 @@ void print_usage(const char *prog_name) {
                   "              show palette preview\n");
   fprintf(stderr, "  " YELLOW "-N, --skip-cursor" RESET
                   "          Skip writing the cursor color sequence\n");
+  fprintf(stderr, "  " YELLOW "-G, --cache-gc" RESET
+                  "             Evict old palettes and compact the cache\n");
+  fprintf(stderr, "  " YELLOW "-W, --warm" RESET " " CYAN "[directory]" RESET
+                  "     Cache palettes for every image in a directory\n");
   fprintf(stderr, "  " YELLOW "-v, --version" RESET
                   "              Show the version number\n");
   fprintf(stderr, "  " YELLOW "-h, --help" RESET
@@ -88,10 +95,14 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
   args->random_mode = RANDOM_ALL;
   args->theme = NULL;
   args->preview = false;
+  args->cache_gc = false;
+  args->warm = false;
+  args->warm_dir = NULL;
 
   static struct option long_options[] = {
       {"mode", required_argument, 0, 'm'},
       {"cols16-mode", required_argument, 0, 'c'},
+      {"engine", required_argument, 0, 'e'},
       {"saturation", required_argument, 0, 's'},
       {"contrast", required_argument, 0, 'C'},
       {"alpha", required_argument, 0, 'a'},
@@ -108,6 +119,8 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
       {"theme", required_argument, 0, 't'},
       {"preview", no_argument, 0, 'p'},
       {"skip-cursor", no_argument, 0, 'N'},
+      {"cache-gc", no_argument, 0, 'G'},
+      {"warm", optional_argument, 0, 'W'},
       {"version", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}};
@@ -116,7 +129,7 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
   int long_index = 0;
   optind = 1;
 
-  while ((opt = getopt_long(argc, argv, "m:c:s:C:a:b:i:S:o:nBTqRr::t:pNvh",
+  while ((opt = getopt_long(argc, argv, "m:c:e:s:C:a:b:i:S:o:nBTqRr::t:pNGW::vh",
                             long_options, &long_index)) != -1) {
     const char *actual_opt = (optarg && argv[optind - 1] == optarg)
                                  ? argv[optind - 2]
@@ -156,6 +169,16 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
         return CLI_ERROR;
       }
       break;
+    case 'e':
+      if (strncmp(optarg, "hsv", 4) == 0) {
+        args->opts.engine = ENGINE_HSV;
+      } else if (strncmp(optarg, "oklch", 6) == 0) {
+        args->opts.engine = ENGINE_OKLCH;
+      } else {
+        logging(ERROR, "Invalid engine: %s. Use 'hsv' or 'oklch'.", optarg);
+        return CLI_ERROR;
+      }
+      break;
     case 's':
       args->opts.saturation = atof(optarg);
       break;
@@ -235,6 +258,20 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
     case 'N':
       args->opts.skip_cursor = true;
       break;
+    case 'G':
+      args->cache_gc = true;
+      break;
+    case 'W':
+      if (!optarg && optind < argc && argv[optind][0] != '-') {
+        optarg = argv[optind++];
+      }
+
+      if (optarg) {
+        free(args->warm_dir);
+        args->warm_dir = strdup(optarg);
+      }
+      args->warm = true;
+      break;
     case 'v':
       printf("cwal v%s\n", CWAL_VERSION);
       return CLI_EXIT;
@@ -249,7 +286,8 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
 
   if (!args->image_path && !args->list_backends && !args->list_themes &&
       !args->use_random_dir && !args->preview && !args->theme &&
-      !args->use_random_theme && !args->restore) {
+      !args->use_random_theme && !args->restore && !args->cache_gc &&
+      !args->warm) {
     logging(ERROR, "Missing --img <image_path>, --random <directory>, "
                    "--theme <theme_name>, or --restore argument.");
     print_usage(argv[0]);
@@ -264,6 +302,17 @@ CliStatus parse_cli_args(int argc, char **argv, Config *config, CliArgs *args) {
     return CLI_ERROR;
   }
 
+  if (args->warm && !args->warm_dir && args->opts.random_dir &&
+      strlen(args->opts.random_dir) > 0) {
+    args->warm_dir = strdup(args->opts.random_dir);
+  }
+  if (args->warm && !args->warm_dir) {
+    logging(ERROR, "No directory to warm. Please provide one via "
+                   "--warm <dir> or set random_dir in your config.");
+    print_usage(argv[0]);
+    return CLI_ERROR;
+  }
+
   if (args->image_path && args->opts.random_dir && args->use_random_dir) {
     logging(ERROR,
             "Cannot use both --img and --random arguments simultaneously.");
@@ -288,5 +337,6 @@ void free_cli_args(CliArgs *args) {
     free(args->opts.out_dir);
     free(args->opts.random_dir);
     free(args->theme);
+    free(args->warm_dir);
   }
 }
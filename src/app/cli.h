@@ -27,6 +27,9 @@ typedef struct {
     RandomMode  random_mode;    // Mode for random theme selection.
     char       *theme;          // Name of the theme to load.
     bool        preview;        // Show palette preview.
+    bool        cache_gc;       // Evict and compact the palette cache.
+    bool        warm;           // Precompute palettes for a directory.
+    char       *warm_dir;       // Directory to warm (random_dir if omitted).
 } CliArgs;
 
 typedef enum {
@@ -9,6 +9,7 @@
  */
 
 #include "config.h"
+#include "backends/backend.h"
 #include "utils/path.h"
 #include "utils/utils.h"
 #include <stdio.h>
@@ -58,6 +59,8 @@ static void parse_key_value(Config *config, const char *key,
     config->opts.saturation = atof(value);
   } else if (strncmp(key, "contrast", 9) == 0) {
     config->opts.contrast = atof(value);
+  } else if (strncmp(key, "dedupe", 7) == 0) {
+    config->opts.dedupe = atof(value);
   } else if (strncmp(key, "script_path", 12) == 0) {
     char *new_value = strdup(value);
     if (!new_value) {
@@ -94,6 +97,15 @@ static void parse_key_value(Config *config, const char *key,
       logging(WARN, "Invalid cols16_mode value in config: %s. Using default.",
               value);
     }
+  } else if (strncmp(key, "engine", 7) == 0) {
+    if (strncmp(value, "hsv", 4) == 0) {
+      config->opts.engine = ENGINE_HSV;
+    } else if (strncmp(value, "oklch", 6) == 0) {
+      config->opts.engine = ENGINE_OKLCH;
+    } else {
+      logging(WARN, "Invalid engine value in config: %s. Using default.",
+              value);
+    }
   } else if (strncmp(key, "skip_cursor", 12) == 0) {
     config->opts.skip_cursor = (strncmp(value, "true", 5) == 0);
   }
@@ -161,6 +173,94 @@ static void parse_link(Config *config, const char *key, const char *value) {
   free(val_copy);
 }
 
+static void set_lua_limit(LuaLimits *limits, const char *key,
+                          const char *value) {
+  if (strncmp(key, "max_instructions", 17) == 0) {
+    limits->max_instructions = atol(value);
+  } else if (strncmp(key, "timeout_ms", 11) == 0) {
+    limits->timeout_ms = atol(value);
+  } else if (strncmp(key, "max_memory_kb", 14) == 0) {
+    limits->max_memory_kb = atol(value);
+  } else if (strncmp(key, "jit", 4) == 0) {
+    limits->jit = (strncmp(value, "true", 5) == 0);
+  } else {
+    logging(WARN, "Unknown [lua] key in config: %s", key);
+  }
+}
+
+static void parse_lua_limit(Config *config, const char *key,
+                            const char *value) {
+  // key = max_instructions | timeout_ms | max_memory_kb | jit
+  // or <backend>.<key> to override one backend
+
+  if (!key || !value || strlen(key) == 0 || strlen(value) == 0)
+    return;
+
+  const char *dot = strrchr(key, '.');
+  if (!dot) {
+    set_lua_limit(&config->lua_limits, key, value);
+    return;
+  }
+
+  size_t name_len = dot - key;
+  for (int i = 0; i < config->num_backend_limits; i++) {
+    LuaLimits *limits = &config->backend_limits[i];
+    if (strlen(limits->backend) == name_len &&
+        strncmp(limits->backend, key, name_len) == 0) {
+      set_lua_limit(limits, dot + 1, value);
+      return;
+    }
+  }
+
+  char *backend = strndup(key, name_len);
+  if (!backend)
+    return;
+  LuaLimits *new_limits = realloc(config->backend_limits,
+                                  sizeof(LuaLimits) *
+                                      (config->num_backend_limits + 1));
+  if (!new_limits) {
+    free(backend);
+    return;
+  }
+  config->backend_limits = new_limits;
+  LuaLimits *limits = &config->backend_limits[config->num_backend_limits++];
+  *limits = (LuaLimits){backend, -1, -1, -1, -1};
+  set_lua_limit(limits, dot + 1, value);
+}
+
+static void parse_cache_option(Config *config, const char *key,
+                               const char *value) {
+  // key = max_entries | max_size_kb | shared_dir | write_sidecars
+
+  if (!key || !value || strlen(key) == 0 || strlen(value) == 0)
+    return;
+
+  if (strncmp(key, "max_entries", 12) == 0) {
+    config->cache_limits.max_entries = atol(value);
+  } else if (strncmp(key, "max_size_kb", 12) == 0) {
+    config->cache_limits.max_size_kb = atol(value);
+  } else if (strncmp(key, "shared_dir", 11) == 0) {
+    free(config->shared_cache);
+    config->shared_cache = strdup(value);
+  } else if (strncmp(key, "write_sidecars", 15) == 0) {
+    if (strcmp(value, "xattr") == 0) {
+      config->sidecar_mode = SIDECAR_XATTR;
+    } else if (strcmp(value, "file") == 0) {
+      config->sidecar_mode = SIDECAR_FILE;
+    } else {
+      config->sidecar_mode = SIDECAR_NONE;
+    }
+  } else {
+    logging(WARN, "Unknown [cache] key in config: %s", key);
+  }
+}
+
+static void write_lua_limit(FILE *file, const char *prefix, const char *key,
+                            long value) {
+  if (value >= 0)
+    fprintf(file, "%s%s = %ld\n", prefix, key, value);
+}
+
 static void create_config_subdirectories(const char *config_dir_path) {
   char *templates_dir = build_path(config_dir_path, "templates");
   if (templates_dir) {
@@ -203,6 +303,14 @@ static void create_config_subdirectories(const char *config_dir_path) {
     }
     free(backends_dir);
   }
+
+  char *filters_dir = build_path(config_dir_path, "filters");
+  if (filters_dir) {
+    if (validate_or_create_dir(filters_dir) != 0) {
+      logging(ERROR, "Failed to create filters directory: %s", filters_dir);
+    }
+    free(filters_dir);
+  }
 }
 
 Config *load_config(void) {
@@ -227,14 +335,22 @@ Config *load_config(void) {
   config->opts.backend = strdup("cwal");
   config->opts.mode = DARK;
   config->opts.cols16_mode = DARKEN;
+  config->opts.engine = ENGINE_HSV;
   config->opts.alpha = 1.0;
   config->opts.saturation = 0.0;
   config->opts.contrast = 1.0;
+  config->opts.dedupe = DEDUPE_DEFAULT_DISTANCE;
   config->opts.script_path = NULL;
   config->opts.random_dir = NULL;
   config->opts.skip_cursor = false;
   config->links = NULL;
   config->num_links = 0;
+  config->lua_limits = (LuaLimits){NULL, 0, 10000, 524288, true};
+  config->backend_limits = NULL;
+  config->num_backend_limits = 0;
+  config->cache_limits = (CacheLimits){50000, 0};
+  config->shared_cache = NULL;
+  config->sidecar_mode = SIDECAR_NONE;
 
   char *config_home = get_config_home();
   char *expanded_path = build_path(config_home, "cwal", "cwal.ini");
@@ -281,6 +397,10 @@ Config *load_config(void) {
 
         if (strncmp(section, "links", 5) == 0) {
           parse_link(config, key, value);
+        } else if (strncmp(section, "lua", 4) == 0) {
+          parse_lua_limit(config, key, value);
+        } else if (strncmp(section, "cache", 6) == 0) {
+          parse_cache_option(config, key, value);
         } else {
           parse_key_value(config, key, value);
         }
@@ -328,11 +448,14 @@ void save_config(const Config *config) {
   fprintf(file, "alpha = %.2f\n", config->opts.alpha);
   fprintf(file, "saturation = %.2f\n", config->opts.saturation);
   fprintf(file, "contrast = %.2f\n", config->opts.contrast);
+  fprintf(file, "dedupe = %.2f\n", config->opts.dedupe);
   fprintf(file, "mode = %s\n", config->opts.mode == DARK ? "dark" : "light");
   fprintf(file, "cols16_mode = %s\n",
           config->opts.cols16_mode == DARKEN
               ? "darken"
               : (config->opts.cols16_mode == LIGHTEN ? "lighten" : "none"));
+  fprintf(file, "engine = %s\n",
+          config->opts.engine == ENGINE_OKLCH ? "oklch" : "hsv");
   fprintf(file, "skip_cursor = %s\n",
           config->opts.skip_cursor ? "true" : "false");
 
@@ -340,6 +463,33 @@ void save_config(const Config *config) {
   fprintf(file, "random_dir = %s\n",
           config->opts.random_dir ? config->opts.random_dir : "");
 
+  fprintf(file, "\n[lua]\n");
+  write_lua_limit(file, "", "max_instructions",
+                  config->lua_limits.max_instructions);
+  write_lua_limit(file, "", "timeout_ms", config->lua_limits.timeout_ms);
+  write_lua_limit(file, "", "max_memory_kb", config->lua_limits.max_memory_kb);
+  fprintf(file, "jit = %s\n", config->lua_limits.jit ? "true" : "false");
+  for (int i = 0; i < config->num_backend_limits; i++) {
+    const LuaLimits *limits = &config->backend_limits[i];
+    char prefix[MAX_LINE_LENGTH];
+    snprintf(prefix, sizeof(prefix), "%s.", limits->backend);
+    write_lua_limit(file, prefix, "max_instructions", limits->max_instructions);
+    write_lua_limit(file, prefix, "timeout_ms", limits->timeout_ms);
+    write_lua_limit(file, prefix, "max_memory_kb", limits->max_memory_kb);
+    if (limits->jit >= 0)
+      fprintf(file, "%sjit = %s\n", prefix, limits->jit ? "true" : "false");
+  }
+
+  fprintf(file, "\n[cache]\n");
+  fprintf(file, "max_entries = %ld\n", config->cache_limits.max_entries);
+  fprintf(file, "max_size_kb = %ld\n", config->cache_limits.max_size_kb);
+  fprintf(file, "shared_dir = %s\n",
+          config->shared_cache ? config->shared_cache : "");
+  fprintf(file, "write_sidecars = %s\n",
+          config->sidecar_mode == SIDECAR_XATTR
+              ? "xattr"
+              : (config->sidecar_mode == SIDECAR_FILE ? "file" : "none"));
+
   if (config->num_links > 0) {
     fprintf(file, "\n[links]\n");
     for (int i = 0; i < config->num_links; i++) {
@@ -370,12 +520,16 @@ void free_config(Config *config) {
     free(config->opts.backend);
     free(config->opts.script_path);
     free(config->opts.random_dir);
+    free(config->shared_cache);
     for (int i = 0; i < config->num_links; i++) {
       free(config->links[i].template_name);
       free(config->links[i].target_path);
       free(config->links[i].reload_cmd);
     }
     free(config->links);
+    for (int i = 0; i < config->num_backend_limits; i++)
+      free(config->backend_limits[i].backend);
+    free(config->backend_limits);
     free(config);
   }
 }
@@ -23,9 +23,11 @@ typedef struct {
 typedef struct {
   COLOR_MODE  mode;         // Theme mode (dark or light).
   SHADE_MODE  cols16_mode;  // 16-color generation mode (darken or lighten).
+  COLOR_ENGINE engine;     // Color space used for post-processing.
   float       alpha;        // Alpha value for the palette.
   float       saturation;   // Saturation adjustment.
   float       contrast;     // Contrast adjustment.
+  float       dedupe;       // OKLab distance merging extracted colors (0 = off).
   char       *backend;      // Image processing backend name.
   char       *script_path;  // Post-hook script path.
   char       *out_dir;      // Output directory for generated files.
@@ -37,6 +39,12 @@ typedef struct {
   AppOptions  opts;        // All shared persistent+CLI-overridable options.
   Link       *links;       // Array of file links (config-only).
   int         num_links;   // Current number of links (config-only).
+  LuaLimits   lua_limits;  // [lua] defaults for every Lua backend.
+  LuaLimits  *backend_limits;     // Per-backend overrides (<backend>.<key>).
+  int         num_backend_limits; // Number of per-backend overrides.
+  CacheLimits cache_limits; // [cache] caps on the palette cache.
+  char       *shared_cache; // [cache] palette store shared by all users.
+  SIDECAR_MODE sidecar_mode; // [cache] where computed palettes are written back.
 } Config;
 
 Config *load_config(void);
@@ -14,6 +14,9 @@
 #include "color/colors.h"
 #include "core.h"
 #include "modules/cache/cache.h"
+#include "modules/cache/sidecar.h"
+#include "modules/cache/warm.h"
+#include "modules/filter/filter.h"
 #include "modules/reload/reload.h"
 #include "modules/template/template.h"
 #include "modules/theme/themes.h"
@@ -48,8 +51,9 @@ int main(int argv, char **argc) {
   set_quiet_mode(args.quiet);
 
   if (args.list_backends) {
-    init_backends();
+    init_backends(NULL);
     list_all_backends();
+    terminate_backends();
     free_config(app_config);
     free_cli_args(&args);
     return 0;
@@ -62,6 +66,15 @@ int main(int argv, char **argc) {
     return 0;
   }
 
+  if (args.cache_gc) {
+    set_palette_cache_limits(&app_config->cache_limits);
+    set_shared_palette_cache(app_config->shared_cache);
+    int status = gc_palette_cache(args.opts.out_dir);
+    free_config(app_config);
+    free_cli_args(&args);
+    return status == 0 ? 0 : 1;
+  }
+
   if (args.preview) {
     logging(INFO, "Current colorscheme:\n");
     preview_palette();
@@ -71,16 +84,41 @@ int main(int argv, char **argc) {
   }
 
   // Initialize backends
-  init_backends();
+  init_backends(args.opts.out_dir);
+  backend_set_lua_limits(&app_config->lua_limits, app_config->backend_limits,
+                         app_config->num_backend_limits);
+  backend_set_dedupe(args.opts.dedupe);
+  set_palette_cache_limits(&app_config->cache_limits);
+  set_shared_palette_cache(app_config->shared_cache);
+  set_sidecar_mode(app_config->sidecar_mode);
 
   // Palette structure initiallation
   Palette palette = {0};
   palette.mode = args.opts.mode;
   palette.cols16_mode = args.opts.cols16_mode;
+  palette.engine = args.opts.engine;
   palette.saturation = args.opts.saturation;
   palette.contrast = args.opts.contrast;
   palette.alpha = args.opts.alpha;
 
+  if (args.warm) {
+    if (palette.cols16_mode == NONE) {
+      palette.cols16_mode = DARKEN;
+    }
+    ImageBackend *backend = backend_get(args.opts.backend);
+    if (!backend) {
+      logging(WARN, "Backend '%s' not found, using 'cwal'.", args.opts.backend);
+      backend = backend_get("cwal");
+    }
+    int failed = backend ? warm_palette_cache(args.warm_dir, &palette, backend,
+                                              args.opts.out_dir)
+                         : -1;
+    terminate_backends();
+    free_config(app_config);
+    free_cli_args(&args);
+    return failed == 0 ? 0 : 1;
+  }
+
   if (args.use_random_theme) {
     if (load_random_theme(&palette, args.random_mode) != 0) {
       free_config(app_config);
@@ -178,34 +216,52 @@ int main(int argv, char **argc) {
     image_to_process_path = NULL;
     ImageBackend *used_backend = backend;
 
-    // Loads colors from cache
-    if (load_palette_from_cache(&palette, args.opts.out_dir,
-                                args.opts.backend) != 0) {
-      // No cache for requested backend, try fallbacks
-      ImageBackend *cached_backend = NULL;
-      for (ImageBackend **candidate = get_all_backends(); *candidate;
-           candidate++) {
-        if (*candidate == backend)
-          continue;
-        if (load_palette_from_cache(&palette, args.opts.out_dir,
-                                    (*candidate)->name) == 0) {
-          cached_backend = *candidate;
-          break;
-        }
+    // Colors shipped with the image need neither the cache nor a decode
+    ImageBackend *cached_backend = load_sidecar_palette(&palette, backend);
+    bool shipped = cached_backend != NULL;
+    if (shipped) {
+      process_colors(&palette);
+    } else {
+      // Loads colors from cache, waiting for any other process already
+      // computing them
+      cached_backend =
+          load_palette_from_cache(&palette, args.opts.out_dir, backend);
+      if (!cached_backend &&
+          lock_palette_computation(&palette, args.opts.out_dir) == 1) {
+        cached_backend =
+            load_palette_from_cache(&palette, args.opts.out_dir, backend);
       }
-
-      if (cached_backend) {
-        used_backend = cached_backend;
-        if (strcmp(args.opts.backend, cached_backend->name) != 0) {
-          logging(WARN, "Backend '%s' failed, using cached palette from '%s'.",
-                  args.opts.backend, cached_backend->name);
-        }
+    }
+    if (cached_backend) {
+      used_backend = cached_backend;
+      if (shipped) {
+        if (strcmp(args.opts.backend, cached_backend->name) != 0)
+          logging(INFO, "Using palette shipped with the image from '%s'.",
+                  cached_backend->name);
+      } else if (strcmp(args.opts.backend, cached_backend->name) != 0) {
+        logging(WARN, "Backend '%s' failed, using cached palette from '%s'.",
+                args.opts.backend, cached_backend->name);
+      }
+    } else {
+      // Parameter changes only need the raw backend colors re-processed
+      ImageBackend *raw_backend =
+          load_raw_palette_from_cache(&palette, args.opts.out_dir, backend);
+      RawImage *image = NULL;
+      if (!raw_backend) {
+        // A resized or re-encoded copy of a cached image has its colors
+        raw_backend = load_similar_palette_from_cache(
+            &palette, args.opts.out_dir, backend, &image);
+      }
+      if (raw_backend) {
+        used_backend = raw_backend;
       } else {
         logging(INFO, "Using backend: %s", args.opts.backend);
 
-        if (process_with_fallback(backend, path, &palette, &used_backend) !=
-            0) {
+        if (process_with_fallback(backend, path, &image, &palette,
+                                  &used_backend) != 0) {
           logging(ERROR, "All backends failed to process the image!");
+          image_free(image);
+          close_palette_cache();
           free(original_requested_backend);
           free(palette.wallpaper);
           palette.wallpaper = NULL;
@@ -214,25 +270,34 @@ int main(int argv, char **argc) {
           return -1;
         }
 
-        const char *actual_backend_name =
-            used_backend ? used_backend->name : args.opts.backend;
-        if (used_backend &&
-            strcmp(args.opts.backend, used_backend->name) != 0) {
-          logging(WARN, "Backend '%s' failed, using '%s'.", args.opts.backend,
-                  used_backend->name);
+        if (save_raw_palette_to_cache(&palette, args.opts.out_dir,
+                                      used_backend->name) != 0) {
+          logging(WARN, "Failed to cache raw palette.");
         }
+        save_sidecar_palette(&palette, used_backend->name);
+      }
+      image_free(image);
 
-        process_colors(&palette);
-        if (save_palette_to_cache(&palette, args.opts.out_dir,
-                                  actual_backend_name) != 0) {
-          logging(WARN, "Failed to cache palette.");
-        }
+      const char *actual_backend_name = used_backend->name;
+      if (strcmp(args.opts.backend, actual_backend_name) != 0) {
+        logging(WARN, "Backend '%s' failed, using '%s'.", args.opts.backend,
+                actual_backend_name);
+      }
+
+      if (save_palette_variants(&palette, args.opts.out_dir,
+                                actual_backend_name) != 0) {
+        logging(WARN, "Failed to cache palette.");
       }
     }
+    close_palette_cache();
 
     free(original_requested_backend);
   }
 
+  // Runs the Lua palette filters
+  apply_palette_filters(&palette, &app_config->lua_limits);
+  terminate_backends();
+
   // Generates template files
   process_template(args.opts.out_dir, &palette, args.opts.skip_cursor);
 
@@ -9,8 +9,11 @@
  */
 
 #include "backend.h"
+#include "color/cluster.h"
 #include "lua_backend.h"
+#include "lua_vm.h"
 #include "utils/path.h"
+#include "utils/utils.h"
 #include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,10 +23,15 @@ extern ImageBackend cwal;
 extern ImageBackend libimagequant;
 
 #define MAX_BACKENDS 64
+#define DEDUPE_HISTOGRAM_BITS 5
 static ImageBackend *available_backends[MAX_BACKENDS];
 static int num_backends = 0;
 static char *lua_script_paths[MAX_BACKENDS];
 static int num_lua_scripts = 0;
+static const LuaLimits *lua_default_limits = NULL;
+static const LuaLimits *lua_backend_limits = NULL;
+static int num_lua_backend_limits = 0;
+static float dedupe_distance = DEDUPE_DEFAULT_DISTANCE;
 
 static void init_builtin_backends() {
   available_backends[num_backends++] = &cwal;
@@ -105,16 +113,41 @@ static void create_lua_backends() {
       continue;
     }
     lua_backend->name = script_name;
+    // The Lua state outlives each run; terminate_backends() closes it.
     lua_backend->init_backend = lua_backend_init;
-    lua_backend->terminate_backend = lua_backend_terminate;
+    lua_backend->terminate_backend = NULL;
     lua_backend->generate_palette = NULL;
     available_backends[num_backends++] = lua_backend;
   }
   available_backends[num_backends] = NULL;
 }
 
+// The [lua] defaults with the fields set in the backend's own overrides.
+static LuaLimits resolve_lua_limits(const char *name) {
+  LuaLimits limits = {NULL, 0, 0, 0, true};
+  if (lua_default_limits)
+    limits = *lua_default_limits;
+
+  for (int i = 0; i < num_lua_backend_limits; i++) {
+    const LuaLimits *o = &lua_backend_limits[i];
+    if (!o->backend || strcmp(o->backend, name) != 0)
+      continue;
+    if (o->max_instructions >= 0)
+      limits.max_instructions = o->max_instructions;
+    if (o->timeout_ms >= 0)
+      limits.timeout_ms = o->timeout_ms;
+    if (o->max_memory_kb >= 0)
+      limits.max_memory_kb = o->max_memory_kb;
+    if (o->jit >= 0)
+      limits.jit = o->jit;
+  }
+  limits.backend = NULL;
+  return limits;
+}
+
 static int run_lua_backend(ImageBackend *backend, const char *script_path,
-                           const char *image_path, Palette *palette) {
+                           const char *image_path, RawImage **raw_img,
+                           Palette *palette) {
   if (!backend || !script_path || !image_path || !palette) {
     return -1;
   }
@@ -123,7 +156,9 @@ static int run_lua_backend(ImageBackend *backend, const char *script_path,
     backend->init_backend();
   }
 
-  int status = lua_generate_palette(script_path, image_path, palette);
+  LuaLimits limits = resolve_lua_limits(backend->name);
+  int status = lua_generate_palette(script_path, image_path, raw_img, palette,
+                                    &limits);
 
   if (backend->terminate_backend) {
     backend->terminate_backend();
@@ -151,23 +186,49 @@ static int run_raw_backend(ImageBackend *backend, RawImage *raw_img,
   return status;
 }
 
+// Replaces near-identical extracted colors with the next most common distinct
+// colors of the image. The quantizers only expose their final colors, so the
+// candidates come from a coarse histogram of the already decoded image, built
+// only when duplicates exist.
+static void dedupe_palette(const RawImage *raw_img, Palette *palette,
+                           int extracted) {
+  if (!has_near_duplicates(palette->colors, extracted, dedupe_distance))
+    return;
+
+  ColorBin *bins = NULL;
+  int num_bins = image_histogram(raw_img, DEDUPE_HISTOGRAM_BITS, &bins);
+  if (num_bins < 0)
+    return;
+  int replaced = dedupe_colors(palette->colors, extracted, bins, num_bins,
+                               dedupe_distance);
+  free(bins);
+
+  if (replaced > 0)
+    logging(INFO, "Replaced %d near-duplicate color(s).", replaced);
+}
+
 int process_with_fallback(ImageBackend *backend, const char *image_path,
-                          Palette *palette, ImageBackend **used_backend) {
-  if (!backend || !image_path || !palette) {
+                          RawImage **image, Palette *palette,
+                          ImageBackend **used_backend) {
+  if (!backend || !image_path || !image || !palette) {
     return -1;
   }
 
-  RawImage *raw_img = NULL;
+  RawImage *raw_img = *image;
   bool processed = false;
+  int extracted = 0; // Colors a native backend extracted; Lua ones are kept
 
   int lua_index = is_lua_backend(backend);
   if (lua_index >= 0) {
     processed = run_lua_backend(backend, lua_script_paths[lua_index],
-                                image_path, palette) == 0;
+                                image_path, &raw_img, palette) == 0;
   } else {
-    raw_img = image_load_from_file(image_path);
+    if (!raw_img) {
+      raw_img = image_load_from_file(image_path);
+    }
     if (raw_img) {
-      processed = run_raw_backend(backend, raw_img, palette) == 0;
+      extracted = run_raw_backend(backend, raw_img, palette);
+      processed = extracted >= 0;
     }
   }
   if (processed && used_backend) {
@@ -188,14 +249,15 @@ int process_with_fallback(ImageBackend *backend, const char *image_path,
     int lua_idx = is_lua_backend(fallback);
     if (lua_idx >= 0) {
       processed = run_lua_backend(fallback, lua_script_paths[lua_idx],
-                                  image_path, palette) == 0;
+                                  image_path, &raw_img, palette) == 0;
     } else {
       if (!raw_img) {
         raw_img = image_load_from_file(image_path);
       }
 
       if (raw_img) {
-        processed = run_raw_backend(fallback, raw_img, palette) == 0;
+        extracted = run_raw_backend(fallback, raw_img, palette);
+        processed = extracted >= 0;
       }
     }
     if (processed && used_backend) {
@@ -203,20 +265,53 @@ int process_with_fallback(ImageBackend *backend, const char *image_path,
     }
   }
 
-  if (raw_img) {
-    image_free(raw_img);
-  }
+  // Colors a script chose are its own business
+  if (processed && extracted > 1 && raw_img)
+    dedupe_palette(raw_img, palette, extracted);
+
+  *image = raw_img;
   return processed ? 0 : -1;
 }
 
-void init_backends() {
+void init_backends(const char *cache_dir) {
   num_backends = 0;
   num_lua_scripts = 0;
+  lua_vm_set_cache_dir(cache_dir);
   init_builtin_backends();
   scan_lua_backends();
   create_lua_backends();
 }
 
+void backend_set_lua_limits(const LuaLimits *defaults,
+                            const LuaLimits *overrides, int num_overrides) {
+  lua_default_limits = defaults;
+  lua_backend_limits = overrides;
+  num_lua_backend_limits = overrides ? num_overrides : 0;
+}
+
+void backend_set_dedupe(float min_distance) {
+  dedupe_distance = min_distance;
+}
+
+float backend_dedupe_distance(void) { return dedupe_distance; }
+
+void terminate_backends(void) {
+  lua_backend_terminate();
+  for (int i = 0; i < num_backends; i++) {
+    if (!available_backends[i]->generate_palette) {
+      free((char *)available_backends[i]->name);
+      free(available_backends[i]);
+    }
+  }
+  for (int i = 0; i < num_lua_scripts; i++)
+    free(lua_script_paths[i]);
+  num_backends = 0;
+  num_lua_scripts = 0;
+  available_backends[0] = NULL;
+  lua_vm_set_cache_dir(NULL);
+  backend_set_lua_limits(NULL, NULL, 0);
+}
+
 ImageBackend *backend_get(const char *name) {
   if (!name)
     return NULL;
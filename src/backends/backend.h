@@ -16,13 +16,27 @@ typedef struct {
   const char *name;
   void (*init_backend)(void);
   void (*terminate_backend)(void);
+  // Writes the extracted colors to the start of palette->colors and returns
+  // how many there are, or -1 on failure.
   int (*generate_palette)(RawImage *image, Palette *palette);
 } ImageBackend;
 
 ImageBackend *backend_get(const char *name);
 ImageBackend **get_all_backends(void);
 void list_all_backends(void);
+// `*image` is the decoded image when the caller already has it, and is left
+// holding whatever image was decoded here, for the caller to free.
 int process_with_fallback(ImageBackend *backend, const char *image_path,
-                          Palette *palette, ImageBackend **used_backend);
-void init_backends(void);
+                          RawImage **image, Palette *palette,
+                          ImageBackend **used_backend);
+void init_backends(const char *cache_dir);
+void terminate_backends(void);
+// Limits applied to Lua backend runs; the arrays must outlive the backends.
+void backend_set_lua_limits(const LuaLimits *defaults,
+                            const LuaLimits *overrides, int num_overrides);
 int is_lua_backend(ImageBackend *backend);
+
+// OKLab distance under which extracted colors count as duplicates; 0 disables.
+#define DEDUPE_DEFAULT_DISTANCE 0.05f
+void backend_set_dedupe(float min_distance);
+float backend_dedupe_distance(void);
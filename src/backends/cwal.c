@@ -56,7 +56,7 @@ static int generate_palette_cwal(RawImage *image, Palette *palette) {
     return -1;
   }
 
-  int status = 0;
+  int status = 8;
 
   for (size_t i = 0; i < 8; i++) {
     if (MagickGetImageColormapColor(wand, i, pixel) == MagickFalse) {
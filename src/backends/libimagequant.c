@@ -39,6 +39,7 @@ static int generate_palette_libimagequant(RawImage *image, Palette *palette) {
   }
 
   const liq_palette *liq_pal = liq_get_palette(res);
+  int count = (int)liq_pal->count;
 
   for (unsigned i = 0; i < liq_pal->count; ++i) {
     palette->colors[i].red = liq_pal->entries[i].r;
@@ -50,7 +51,7 @@ static int generate_palette_libimagequant(RawImage *image, Palette *palette) {
   liq_image_destroy(liq_img);
   liq_attr_destroy(attr);
 
-  return 0;
+  return count;
 }
 
 ImageBackend libimagequant = {.name = "libimagequant",
@@ -10,108 +10,192 @@
 
 #include "core.h"
 #include "lua_backend.h"
+#include "lua_cwal.h"
+#include "lua_vm.h"
 #include "utils/utils.h"
 #include <lauxlib.h>
 #include <lua.h>
-#include <lualib.h>
 
-static lua_State *lua_state = NULL;
+void lua_backend_init() { lua_vm_state(); }
 
-void lua_backend_init() {
-  if (lua_state)
-    lua_close(lua_state);
-  lua_state = luaL_newstate();
-  if (!lua_state)
-    return;
-  luaL_openlibs(lua_state);
-}
+void lua_backend_terminate() { lua_vm_close(); }
+
+typedef struct {
+  const char *image_path;
+  RawImage **image;
+  bool closed; // Main returned; the path and buffer may be gone
+} LazyImage;
 
-void lua_backend_terminate() {
-  if (lua_state) {
-    lua_close(lua_state);
-    lua_state = NULL;
+// Decodes the image on first use; the decoded buffer is shared with the
+// native backends for the rest of the fallback chain.
+static RawImage *decode_lazy_image(lua_State *L, LazyImage *lazy) {
+  if (lazy->closed)
+    luaL_error(L, "image used after Main returned");
+  if (!lazy->image)
+    return NULL;
+
+  if (!*lazy->image) {
+    *lazy->image = image_load_from_file(lazy->image_path);
+    if (!*lazy->image)
+      luaL_error(L, "failed to decode image: %s", lazy->image_path);
   }
+  return *lazy->image;
 }
 
-static int load_lua_script(const char *script_path) {
-  if (!lua_state)
-    return -1;
-  if (luaL_loadfile(lua_state, script_path) != LUA_OK) {
-    const char *message = lua_tostring(lua_state, -1);
-    logging(ERROR, "Failed to load Lua backend: %s", message);
-    lua_pop(lua_state, 1);
-    return -1;
-  }
-  if (lua_pcall(lua_state, 0, 0, 0) != LUA_OK) {
-    const char *message = lua_tostring(lua_state, -1);
-    logging(ERROR, "Failed to initialize Lua backend: %s", message);
-    lua_pop(lua_state, 1);
-    return -1;
+// __index for the image table handed to Main. The image is decoded on first
+// field access, so path-only scripts never pay for it.
+static int lazy_image_index(lua_State *L) {
+  RawImage *img = decode_lazy_image(L, lua_touserdata(L, lua_upvalueindex(1)));
+  if (!img)
+    return 0;
+
+  lua_pushlightuserdata(L, img->pixels);
+  lua_setfield(L, 1, "pixels");
+  lua_pushinteger(L, img->width);
+  lua_setfield(L, 1, "width");
+  lua_pushinteger(L, img->height);
+  lua_setfield(L, 1, "height");
+  lua_pushinteger(L, img->channels);
+  lua_setfield(L, 1, "channels");
+  lua_pushinteger(L, (lua_Integer)img->width * img->channels);
+  lua_setfield(L, 1, "stride");
+
+  lua_pushvalue(L, 2);
+  lua_rawget(L, 1);
+  return 1;
+}
+
+// Loader bound for the cwal natives, which read the RawImage itself.
+static int lazy_image_load(lua_State *L) {
+  RawImage *img = decode_lazy_image(L, lua_touserdata(L, lua_upvalueindex(1)));
+  if (!img)
+    return 0;
+  lua_pushlightuserdata(L, img);
+  return 1;
+}
+
+// Pushes the image argument for Main: a table whose pixels field is a
+// pointer usable with ffi.cast("const uint8_t *", image.pixels). It is only
+// valid for the duration of the call; see close_lazy_image.
+static LazyImage *push_lazy_image(lua_State *L, const char *image_path,
+                                  RawImage **image) {
+  lua_newtable(L);
+  lua_newtable(L);
+  LazyImage *lazy = lua_newuserdata(L, sizeof(LazyImage));
+  *lazy = (LazyImage){image_path, image, false};
+  lua_pushvalue(L, -1);
+  lua_pushcclosure(L, lazy_image_index, 1);
+  lua_setfield(L, -3, "__index");
+  lua_pushcclosure(L, lazy_image_load, 1);
+  lua_cwal_bind_image(L, -3);
+  lua_setmetatable(L, -2);
+  return lazy;
+}
+
+// A script may keep the image table past Main, and the VM outlives the run.
+// Unbinds the table and drops the fields pointing into the buffer, so later
+// reads reach lazy_image_index and fail there instead of touching freed
+// memory.
+static void close_lazy_image(lua_State *L, int idx, LazyImage *lazy) {
+  static const char *fields[] = {"pixels", "width", "height", "channels",
+                                 "stride"};
+  lazy->closed = true;
+  lua_pushnil(L);
+  lua_cwal_bind_image(L, idx);
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    lua_pushnil(L);
+    lua_setfield(L, idx, fields[i]);
   }
-  return 0;
 }
 
-static int extract_colors_from_lua(Palette *palette) {
-  if (!lua_state)
-    return -1;
-  if (!lua_istable(lua_state, -1)) {
+static int extract_colors_from_lua(lua_State *L, Palette *palette) {
+  if (!lua_istable(L, -1)) {
     logging(ERROR, "Lua backend must return a table.");
     return -1;
   }
-  size_t table_len = lua_objlen(lua_state, -1);
+  size_t table_len = lua_objlen(L, -1);
   if (table_len != 16) {
     logging(ERROR, "Lua backend Main must return exactly 16 colors, got %zu.",
             table_len);
     return -1;
   }
   for (int i = 0; i < 16; i++) {
-    lua_rawgeti(lua_state, -1, i + 1);
-    if (!lua_istable(lua_state, -1)) {
+    lua_rawgeti(L, -1, i + 1);
+    if (!lua_istable(L, -1)) {
       logging(ERROR, "Lua backend color %d must be a table.", i + 1);
-      lua_pop(lua_state, 1);
+      lua_pop(L, 1);
       return -1;
     }
-    lua_rawgeti(lua_state, -1, 1);
-    lua_rawgeti(lua_state, -2, 2);
-    lua_rawgeti(lua_state, -3, 3);
-    if (!lua_isnumber(lua_state, -3) || !lua_isnumber(lua_state, -2) ||
-        !lua_isnumber(lua_state, -1)) {
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    lua_rawgeti(L, -3, 3);
+    if (!lua_isnumber(L, -3) || !lua_isnumber(L, -2) || !lua_isnumber(L, -1)) {
       logging(ERROR,
               "Lua backend color %d must contain numeric r, g, and b values.",
               i + 1);
-      lua_pop(lua_state, 3);
+      lua_pop(L, 4);
       return -1;
     }
-    uint8_t r = (uint8_t)lua_tointeger(lua_state, -3);
-    uint8_t g = (uint8_t)lua_tointeger(lua_state, -2);
-    uint8_t b = (uint8_t)lua_tointeger(lua_state, -1);
+    uint8_t r = (uint8_t)lua_tointeger(L, -3);
+    uint8_t g = (uint8_t)lua_tointeger(L, -2);
+    uint8_t b = (uint8_t)lua_tointeger(L, -1);
     palette->colors[i] = (Color){r, g, b};
-    lua_pop(lua_state, 4);
+    lua_pop(L, 4);
   }
-  lua_pop(lua_state, 1);
   return 0;
 }
 
-int lua_generate_palette(const char *script_path, const char *image_path,
-                         Palette *palette) {
-  if (!script_path || !image_path || !palette)
-    return -1;
-  if (load_lua_script(script_path) != 0)
+static int call_main(lua_State *L, const char *script_path,
+                     const char *image_path, RawImage **image,
+                     Palette *palette) {
+  int top = lua_gettop(L);
+  if (lua_vm_push_script(script_path) != 0)
     return -1;
-  lua_getglobal(lua_state, "Main");
-  if (!lua_isfunction(lua_state, -1)) {
+
+  int script = lua_gettop(L);
+  LazyImage *lazy = push_lazy_image(L, image_path, image);
+  int image_idx = lua_gettop(L);
+
+  lua_getfield(L, script, "Main");
+  if (!lua_isfunction(L, -1)) {
     logging(ERROR, "Lua backend script must define Main(image_path).");
-    lua_pop(lua_state, 1);
+    lua_settop(L, top);
     return -1;
   }
-  lua_pushstring(lua_state, image_path);
-  if (lua_pcall(lua_state, 1, 1, 0) != LUA_OK) {
-    const char *message = lua_tostring(lua_state, -1);
-    logging(ERROR, "Failed to execute Lua backend: %s", message);
-    lua_pop(lua_state, 1);
+
+  lua_pushstring(L, image_path);
+  lua_pushvalue(L, image_idx);
+  int call_status = lua_pcall(L, 2, 1, 0);
+  close_lazy_image(L, image_idx, lazy);
+  if (call_status != LUA_OK) {
+    logging(ERROR, "Failed to execute Lua backend: %s", lua_tostring(L, -1));
+    lua_settop(L, top);
     return -1;
   }
-  if (extract_colors_from_lua(palette) != 0)
+
+  int status = extract_colors_from_lua(L, palette);
+  lua_settop(L, top);
+  return status;
+}
+
+int lua_generate_palette(const char *script_path, const char *image_path,
+                         RawImage **image, Palette *palette,
+                         const LuaLimits *limits) {
+  if (!script_path || !image_path || !palette)
     return -1;
-  return 0;
+  lua_State *L = lua_vm_state();
+  if (!L)
+    return -1;
+
+  // Loading the script runs its top level, so it is budgeted too.
+  if (limits)
+    lua_vm_begin_run(limits);
+  int status = call_main(L, script_path, image_path, image, palette);
+  const char *exceeded = lua_vm_end_run();
+  if (exceeded) {
+    logging(ERROR, "Lua backend %s stopped: %s exceeded.", script_path,
+            exceeded);
+    status = -1;
+  }
+  return status;
 }
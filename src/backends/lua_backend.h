@@ -10,9 +10,11 @@
 
 #pragma once
 
+#include "color/image.h"
 #include "core.h"
 
 void lua_backend_init(void);
 void lua_backend_terminate(void);
 int lua_generate_palette(const char *script_path, const char *image_path,
-                         Palette *palette);
+                         RawImage **image, Palette *palette,
+                         const LuaLimits *limits);
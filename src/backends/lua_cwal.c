@@ -0,0 +1,463 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "lua_cwal.h"
+#include "color/cluster.h"
+#include "color/color_batch.h"
+#include "color/color_operation.h"
+#include "color/colors.h"
+#include "utils/utils.h"
+#include <lauxlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_HISTOGRAM_BITS 5
+#define DEFAULT_KMEANS_ITERATIONS 10
+#define IMAGES_KEY "cwal.images"
+
+typedef enum { SPACE_HSL, SPACE_HSV, SPACE_LAB } ColorSpace;
+
+static const char *space_fields[][3] = {
+    {"h", "s", "l"}, {"h", "s", "v"}, {"l", "a", "b"}};
+
+// Scratch buffers live on the Lua stack as userdata so that luaL_error can
+// unwind without leaking.
+static void *scratch(lua_State *L, size_t size) {
+  return lua_newuserdata(L, size ? size : 1);
+}
+
+static int free_box(lua_State *L) {
+  void **box = lua_touserdata(L, 1);
+  free(*box);
+  *box = NULL;
+  return 0;
+}
+
+// Pushes a userdata owning a malloc'd pointer, so a Lua error raised while
+// the buffer is in use (a refused allocation, say) does not leak it.
+static void **gc_box(lua_State *L) {
+  void **box = lua_newuserdata(L, sizeof(void *));
+  *box = NULL;
+  if (luaL_newmetatable(L, "cwal.box")) {
+    lua_pushcfunction(L, free_box);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+  return box;
+}
+
+// Reads an image table passed to Main. Only tables bound with
+// lua_cwal_bind_image are images: the pixels and geometry come from the
+// decoded image, never from the table's fields, which the script can
+// overwrite. Calling the loader triggers the lazy decode.
+static bool read_image(lua_State *L, int idx, RawImage *image) {
+  if (!lua_istable(L, idx))
+    return false;
+
+  lua_getfield(L, LUA_REGISTRYINDEX, IMAGES_KEY);
+  lua_pushvalue(L, idx);
+  lua_rawget(L, -2);
+  lua_remove(L, -2);
+  if (!lua_isfunction(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+  lua_call(L, 0, 1);
+  const RawImage *source = lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  if (!source)
+    return false;
+
+  *image = *source;
+  if (!image->pixels || image->width <= 0 || image->height <= 0 ||
+      image->channels < 3)
+    luaL_error(L, "invalid image dimensions");
+  return true;
+}
+
+static Color check_color(lua_State *L, int idx) {
+  luaL_checktype(L, idx, LUA_TTABLE);
+  float rgb[3];
+  for (int c = 0; c < 3; c++) {
+    lua_rawgeti(L, idx, c + 1);
+    if (!lua_isnumber(L, -1))
+      luaL_error(L, "color must contain numeric r, g, and b values");
+    rgb[c] = (float)lua_tonumber(L, -1);
+    lua_pop(L, 1);
+  }
+  return (Color){clamp_byte(rgb[0]), clamp_byte(rgb[1]), clamp_byte(rgb[2])};
+}
+
+static void push_color(lua_State *L, Color clr) {
+  lua_createtable(L, 3, 0);
+  lua_pushinteger(L, clr.red);
+  lua_rawseti(L, -2, 1);
+  lua_pushinteger(L, clr.green);
+  lua_rawseti(L, -2, 2);
+  lua_pushinteger(L, clr.blue);
+  lua_rawseti(L, -2, 3);
+}
+
+static void push_colors(lua_State *L, const Color *colors, int count) {
+  lua_createtable(L, count, 0);
+  for (int i = 0; i < count; i++) {
+    push_color(L, colors[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+}
+
+// Reads a list of {r, g, b} tables into a scratch Color array.
+static Color *check_colors(lua_State *L, int idx, size_t *count) {
+  luaL_checktype(L, idx, LUA_TTABLE);
+  *count = lua_objlen(L, idx);
+  Color *colors = scratch(L, *count * sizeof(Color));
+  for (size_t i = 0; i < *count; i++) {
+    lua_rawgeti(L, idx, (int)i + 1);
+    colors[i] = check_color(L, lua_gettop(L));
+    lua_pop(L, 1);
+  }
+  return colors;
+}
+
+// Clustering input: either an image (histogrammed at 2^(3*bits) bins) or a
+// list of {r, g, b[, count]} entries such as the output of cwal.histogram.
+static ColorBin *check_bins(lua_State *L, int idx, int *count) {
+  RawImage image;
+  if (read_image(L, idx, &image)) {
+    void **box = gc_box(L);
+    ColorBin *bins = NULL;
+    int n = image_histogram(&image, DEFAULT_HISTOGRAM_BITS, &bins);
+    *box = bins;
+    if (n < 0)
+      luaL_error(L, "failed to build histogram");
+    ColorBin *copy = scratch(L, (size_t)n * sizeof(ColorBin));
+    memcpy(copy, bins, (size_t)n * sizeof(ColorBin));
+    free(bins);
+    *box = NULL;
+    *count = n;
+    return copy;
+  }
+
+  luaL_checktype(L, idx, LUA_TTABLE);
+  int n = (int)lua_objlen(L, idx);
+  ColorBin *bins = scratch(L, (size_t)n * sizeof(ColorBin));
+  for (int i = 0; i < n; i++) {
+    lua_rawgeti(L, idx, i + 1);
+    int entry = lua_gettop(L);
+    bins[i].color = check_color(L, entry);
+    lua_rawgeti(L, entry, 4);
+    lua_Number weight = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : 1;
+    bins[i].count = weight > 0 ? (uint32_t)weight : 0;
+    lua_pop(L, 2);
+  }
+  *count = n;
+  return bins;
+}
+
+// cwal.histogram(image[, bits]) -> {{r, g, b, count}, ...}
+static int l_histogram(lua_State *L) {
+  RawImage image;
+  if (!read_image(L, 1, &image))
+    return luaL_argerror(L, 1, "image expected");
+  int bits = (int)luaL_optinteger(L, 2, DEFAULT_HISTOGRAM_BITS);
+
+  void **box = gc_box(L);
+  ColorBin *bins = NULL;
+  int n = image_histogram(&image, bits, &bins);
+  *box = bins;
+  if (n < 0)
+    return luaL_error(L, "failed to build histogram");
+
+  lua_createtable(L, n, 0);
+  for (int i = 0; i < n; i++) {
+    push_color(L, bins[i].color);
+    lua_pushinteger(L, bins[i].count);
+    lua_rawseti(L, -2, 4);
+    lua_rawseti(L, -2, i + 1);
+  }
+  free(bins);
+  *box = NULL;
+  return 1;
+}
+
+// cwal.kmeans(image_or_bins, k[, iterations]) -> {{r, g, b}, ...}
+static int l_kmeans(lua_State *L) {
+  int k = (int)luaL_checkinteger(L, 2);
+  int iterations = (int)luaL_optinteger(L, 3, DEFAULT_KMEANS_ITERATIONS);
+  luaL_argcheck(L, k > 0, 2, "k must be positive");
+
+  int num_bins;
+  ColorBin *bins = check_bins(L, 1, &num_bins);
+  Color *out = scratch(L, (size_t)k * sizeof(Color));
+  push_colors(L, out, kmeans_colors(bins, num_bins, k, iterations, out));
+  return 1;
+}
+
+// cwal.median_cut(image_or_bins, k) -> {{r, g, b}, ...}
+static int l_median_cut(lua_State *L) {
+  int k = (int)luaL_checkinteger(L, 2);
+  luaL_argcheck(L, k > 0, 2, "k must be positive");
+
+  int num_bins;
+  ColorBin *bins = check_bins(L, 1, &num_bins);
+  Color *out = scratch(L, (size_t)k * sizeof(Color));
+  push_colors(L, out, median_cut_colors(bins, num_bins, k, out));
+  return 1;
+}
+
+static void forward_batch(ColorSpace space, const uint8_t *pixels,
+                          size_t step, void *out, size_t count) {
+  switch (space) {
+  case SPACE_HSL:
+    rgb_to_hsl_batch(pixels, step, out, count);
+    break;
+  case SPACE_HSV:
+    rgb_to_hsv_batch(pixels, step, out, count);
+    break;
+  case SPACE_LAB:
+    rgb_to_lab_batch(pixels, step, out, count);
+    break;
+  }
+}
+
+// Component order of the Lua tables, independent of the struct layout.
+static void to_components(ColorSpace space, const void *in, size_t i,
+                          float out[3]) {
+  switch (space) {
+  case SPACE_HSL: {
+    HSL v = ((const HSL *)in)[i];
+    out[0] = v.h, out[1] = v.s, out[2] = v.l;
+    break;
+  }
+  case SPACE_HSV: {
+    HSV v = ((const HSV *)in)[i];
+    out[0] = v.h, out[1] = v.s, out[2] = v.v;
+    break;
+  }
+  case SPACE_LAB: {
+    Lab v = ((const Lab *)in)[i];
+    out[0] = v.l, out[1] = v.a, out[2] = v.b;
+    break;
+  }
+  }
+}
+
+// rgb_to_<space>(colors) returns a list of keyed tables. Given an image it
+// returns a userdata holding width*height structs (the C layout, e.g.
+// `struct { float h, l, s; }` for HSL) plus the element count, ready for
+// ffi.cast.
+static int convert_from_rgb(lua_State *L, ColorSpace space) {
+  static const size_t elem_size[] = {sizeof(HSL), sizeof(HSV), sizeof(Lab)};
+
+  RawImage image;
+  if (read_image(L, 1, &image)) {
+    size_t count = (size_t)image.width * image.height;
+    void *out = lua_newuserdata(L, count * elem_size[space]);
+    forward_batch(space, image.pixels, image.channels, out, count);
+    lua_pushinteger(L, (lua_Integer)count);
+    return 2;
+  }
+
+  size_t count;
+  Color *colors = check_colors(L, 1, &count);
+  void *out = scratch(L, count * elem_size[space]);
+  forward_batch(space, (const uint8_t *)colors, sizeof(Color), out, count);
+
+  lua_createtable(L, (int)count, 0);
+  for (size_t i = 0; i < count; i++) {
+    float c[3];
+    to_components(space, out, i, c);
+    lua_createtable(L, 0, 3);
+    for (int j = 0; j < 3; j++) {
+      lua_pushnumber(L, c[j]);
+      lua_setfield(L, -2, space_fields[space][j]);
+    }
+    lua_rawseti(L, -2, (int)i + 1);
+  }
+  return 1;
+}
+
+// <space>_to_rgb(list of keyed tables) -> {{r, g, b}, ...}
+static int convert_to_rgb(lua_State *L, ColorSpace space) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  size_t count = lua_objlen(L, 1);
+  float *in = scratch(L, count * 3 * sizeof(float));
+  Color *out = scratch(L, count * sizeof(Color));
+
+  for (size_t i = 0; i < count; i++) {
+    lua_rawgeti(L, 1, (int)i + 1);
+    luaL_checktype(L, -1, LUA_TTABLE);
+    for (int j = 0; j < 3; j++) {
+      lua_getfield(L, -1, space_fields[space][j]);
+      in[i * 3 + j] = (float)luaL_checknumber(L, -1);
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+  }
+
+  // Repack into the struct layout the batch kernels expect.
+  switch (space) {
+  case SPACE_HSL: {
+    HSL *hsl = scratch(L, count * sizeof(HSL));
+    for (size_t i = 0; i < count; i++)
+      hsl[i] = (HSL){in[i * 3], in[i * 3 + 2], in[i * 3 + 1]};
+    hsl_to_rgb_batch(hsl, out, count);
+    break;
+  }
+  case SPACE_HSV: {
+    HSV *hsv = scratch(L, count * sizeof(HSV));
+    for (size_t i = 0; i < count; i++)
+      hsv[i] = (HSV){in[i * 3], in[i * 3 + 1], in[i * 3 + 2]};
+    hsv_to_rgb_batch(hsv, out, count);
+    break;
+  }
+  case SPACE_LAB: {
+    Lab *lab = scratch(L, count * sizeof(Lab));
+    for (size_t i = 0; i < count; i++)
+      lab[i] = (Lab){in[i * 3], in[i * 3 + 1], in[i * 3 + 2]};
+    lab_to_rgb_batch(lab, out, count);
+    break;
+  }
+  }
+
+  push_colors(L, out, (int)count);
+  return 1;
+}
+
+static int l_rgb_to_hsl(lua_State *L) { return convert_from_rgb(L, SPACE_HSL); }
+static int l_rgb_to_hsv(lua_State *L) { return convert_from_rgb(L, SPACE_HSV); }
+static int l_rgb_to_lab(lua_State *L) { return convert_from_rgb(L, SPACE_LAB); }
+static int l_hsl_to_rgb(lua_State *L) { return convert_to_rgb(L, SPACE_HSL); }
+static int l_hsv_to_rgb(lua_State *L) { return convert_to_rgb(L, SPACE_HSV); }
+static int l_lab_to_rgb(lua_State *L) { return convert_to_rgb(L, SPACE_LAB); }
+
+// cwal.luminance({r, g, b}) -> relative luminance (0..1)
+static int l_luminance(lua_State *L) {
+  lua_pushnumber(L, w3_luminance(check_color(L, 1)));
+  return 1;
+}
+
+// cwal.contrast_ratio(a, b) -> WCAG contrast ratio (1..21)
+static int l_contrast_ratio(lua_State *L) {
+  lua_pushnumber(L, contrast_ratio(check_color(L, 1), check_color(L, 2)));
+  return 1;
+}
+
+// cwal.darken/lighten/saturate(color, amount) -> {r, g, b}
+static int l_darken(lua_State *L) {
+  Color clr = check_color(L, 1);
+  push_color(L, darken_color(clr, (float)luaL_checknumber(L, 2)));
+  return 1;
+}
+
+static int l_lighten(lua_State *L) {
+  Color clr = check_color(L, 1);
+  push_color(L, lighten_color(clr, (float)luaL_checknumber(L, 2)));
+  return 1;
+}
+
+static int l_saturate(lua_State *L) {
+  Color clr = check_color(L, 1);
+  push_color(L, saturate_color(clr, (float)luaL_checknumber(L, 2)));
+  return 1;
+}
+
+static const char *opt_string(lua_State *L, int idx, const char *key,
+                              const char *def) {
+  lua_getfield(L, idx, key);
+  const char *value = lua_isstring(L, -1) ? lua_tostring(L, -1) : def;
+  lua_pop(L, 1);
+  return value;
+}
+
+static float opt_number(lua_State *L, int idx, const char *key, float def) {
+  lua_getfield(L, idx, key);
+  float value = lua_isnumber(L, -1) ? (float)lua_tonumber(L, -1) : def;
+  lua_pop(L, 1);
+  return value;
+}
+
+// cwal.process_colors(colors, {mode=, cols16=, engine=, saturation=,
+//                              contrast=})
+// Runs the same post-processing as the built-in backends on 16 raw colors.
+static int l_process_colors(lua_State *L) {
+  size_t count;
+  Color *colors = check_colors(L, 1, &count);
+  if (count != PALETTE_MAX_SIZE)
+    return luaL_argerror(L, 1, "exactly 16 colors expected");
+
+  Palette palette = {0};
+  memcpy(palette.colors, colors, sizeof(palette.colors));
+  palette.mode = DARK;
+  palette.cols16_mode = DARKEN;
+  palette.saturation = 0.0f;
+  palette.contrast = 1.0f;
+
+  if (lua_istable(L, 2)) {
+    const char *mode = opt_string(L, 2, "mode", "dark");
+    const char *cols16 = opt_string(L, 2, "cols16", "darken");
+    palette.mode = strcmp(mode, "light") == 0 ? LIGHT : DARK;
+    palette.cols16_mode = strcmp(cols16, "lighten") == 0 ? LIGHTEN : DARKEN;
+    const char *engine = opt_string(L, 2, "engine", "hsv");
+    palette.engine = strcmp(engine, "oklch") == 0 ? ENGINE_OKLCH : ENGINE_HSV;
+    palette.saturation = opt_number(L, 2, "saturation", palette.saturation);
+    palette.contrast = opt_number(L, 2, "contrast", palette.contrast);
+  }
+
+  process_colors(&palette);
+  push_colors(L, palette.colors, PALETTE_MAX_SIZE);
+  return 1;
+}
+
+static const luaL_Reg cwal_functions[] = {
+    {"histogram", l_histogram},
+    {"kmeans", l_kmeans},
+    {"median_cut", l_median_cut},
+    {"rgb_to_hsl", l_rgb_to_hsl},
+    {"rgb_to_hsv", l_rgb_to_hsv},
+    {"rgb_to_lab", l_rgb_to_lab},
+    {"hsl_to_rgb", l_hsl_to_rgb},
+    {"hsv_to_rgb", l_hsv_to_rgb},
+    {"lab_to_rgb", l_lab_to_rgb},
+    {"luminance", l_luminance},
+    {"contrast_ratio", l_contrast_ratio},
+    {"darken", l_darken},
+    {"lighten", l_lighten},
+    {"saturate", l_saturate},
+    {"process_colors", l_process_colors},
+    {NULL, NULL},
+};
+
+void lua_cwal_bind_image(lua_State *L, int idx) {
+  if (idx < 0 && idx > LUA_REGISTRYINDEX)
+    idx = lua_gettop(L) + idx + 1;
+  lua_getfield(L, LUA_REGISTRYINDEX, IMAGES_KEY);
+  lua_pushvalue(L, idx);
+  lua_pushvalue(L, -3);
+  lua_rawset(L, -3);
+  lua_pop(L, 2);
+}
+
+int luaopen_cwal(lua_State *L) {
+  // Bound image tables, weakly keyed so a table the script drops is not
+  // kept alive by its binding
+  lua_newtable(L);
+  lua_createtable(L, 0, 1);
+  lua_pushliteral(L, "k");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_setfield(L, LUA_REGISTRYINDEX, IMAGES_KEY);
+
+  lua_newtable(L);
+  luaL_register(L, NULL, cwal_functions);
+  lua_pushstring(L, color_batch_level_name(color_batch_level()));
+  lua_setfield(L, -2, "simd");
+  return 1;
+}
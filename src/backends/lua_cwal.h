@@ -0,0 +1,23 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include <lua.h>
+
+// Opens the native `cwal` module (histogram, clustering, color conversion,
+// contrast helpers and process_colors) and leaves it on the stack.
+int luaopen_cwal(lua_State *L);
+
+// Lets the natives take the table at `idx` as an image. The function on top
+// of the stack, which is popped, returns the decoded RawImage as a light
+// userdata; binding nil withdraws the table. Any other table is rejected,
+// so a script cannot point the natives at memory of its choosing.
+void lua_cwal_bind_image(lua_State *L, int idx);
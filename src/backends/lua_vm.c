@@ -0,0 +1,472 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "lua_vm.h"
+#include "lua_cwal.h"
+#include "utils/hash.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+#include <lauxlib.h>
+#include <limits.h>
+#include <luajit.h>
+#include <lualib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define BYTECODE_MAGIC "CWALBC2"
+#define SCRIPTS_KEY "cwal.scripts"
+#define STAMPS_KEY "cwal.stamps"
+#define HOOK_INTERVAL 1000 // Instructions between budget checks
+
+// Edits within one second that keep the size still change the nanoseconds,
+// and editors that save by rename change the inode.
+typedef struct {
+  char magic[8];
+  int64_t mtime;
+  int64_t mtime_nsec;
+  int64_t size;
+  uint64_t inode;
+} BytecodeHeader;
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} DumpBuffer;
+
+typedef struct {
+  size_t in_use; // Bytes currently allocated by the state
+  size_t limit;  // Allocation ceiling for the current run, 0 for none
+  bool refused;  // An allocation hit the ceiling
+} AllocState;
+
+typedef struct {
+  LuaLimits limits;
+  long instructions;    // Executed so far, counted per hook call
+  long interval;        // Instructions between count hook calls
+  int memory_base_kb;   // lua_gc count at the start of the run
+  const char *exceeded; // Limit that stopped the run
+  bool jit_disabled;    // The run turned the JIT off; turn it back on after
+  bool timed;           // The deadline timer is armed
+  struct sigaction previous_alarm;
+  bool active;
+} RunBudget;
+
+static lua_State *vm_state = NULL;
+static char *bytecode_dir = NULL;
+static AllocState alloc_state = {0};
+static bool tracked_alloc = false;
+static RunBudget budget = {0};
+
+// State allocator that refuses to grow past the run's ceiling; Lua turns the
+// refusal into a regular memory error.
+static void *limited_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+  AllocState *state = ud;
+  if (nsize == 0) {
+    free(ptr);
+    state->in_use -= osize;
+    return NULL;
+  }
+  if (state->limit && nsize > osize &&
+      state->in_use - osize + nsize > state->limit) {
+    state->refused = true;
+    return NULL;
+  }
+
+  void *block = realloc(ptr, nsize);
+  if (block)
+    state->in_use = state->in_use - osize + nsize;
+  return block;
+}
+
+lua_State *lua_vm_state(void) {
+  if (vm_state)
+    return vm_state;
+
+  alloc_state = (AllocState){0};
+  vm_state = lua_newstate(limited_alloc, &alloc_state);
+  tracked_alloc = vm_state != NULL;
+  if (!vm_state) {
+    // 64-bit LuaJIT builds without GC64 only accept their own allocator; the
+    // memory limit then falls back to polling the GC count from the hook.
+    vm_state = luaL_newstate();
+  }
+  if (!vm_state) {
+    logging(ERROR, "Failed to create Lua state.");
+    return NULL;
+  }
+  luaL_openlibs(vm_state);
+
+  // Native helpers, available as the global `cwal` and via require("cwal")
+  luaopen_cwal(vm_state);
+  lua_getglobal(vm_state, "package");
+  lua_getfield(vm_state, -1, "loaded");
+  lua_pushvalue(vm_state, -3);
+  lua_setfield(vm_state, -2, "cwal");
+  lua_pop(vm_state, 2);
+  lua_setglobal(vm_state, "cwal");
+
+  lua_newtable(vm_state);
+  lua_setfield(vm_state, LUA_REGISTRYINDEX, SCRIPTS_KEY);
+  lua_newtable(vm_state);
+  lua_setfield(vm_state, LUA_REGISTRYINDEX, STAMPS_KEY);
+  return vm_state;
+}
+
+void lua_vm_close(void) {
+  if (vm_state) {
+    lua_close(vm_state);
+    vm_state = NULL;
+  }
+}
+
+void lua_vm_set_cache_dir(const char *cache_dir) {
+  free(bytecode_dir);
+  bytecode_dir = NULL;
+  if (!cache_dir)
+    return;
+
+  char *expanded = expand_home(cache_dir);
+  if (expanded) {
+    bytecode_dir = build_path(expanded, "bytecode");
+    free(expanded);
+  }
+}
+
+static char *bytecode_path(const char *script_path) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bc",
+           (unsigned long long)hash_string(script_path, 0));
+  return build_path(bytecode_dir, name);
+}
+
+static int dump_writer(lua_State *L, const void *p, size_t sz, void *ud) {
+  (void)L;
+  DumpBuffer *buf = ud;
+  if (buf->len + sz > buf->cap) {
+    size_t cap = buf->cap ? buf->cap * 2 : 4096;
+    while (cap < buf->len + sz)
+      cap *= 2;
+    char *data = realloc(buf->data, cap);
+    if (!data)
+      return 1;
+    buf->data = data;
+    buf->cap = cap;
+  }
+  memcpy(buf->data + buf->len, p, sz);
+  buf->len += sz;
+  return 0;
+}
+
+static int load_cached_bytecode(lua_State *L, const char *path,
+                                const char *chunkname,
+                                const struct stat *st) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return -1;
+
+  BytecodeHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, BYTECODE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.mtime != (int64_t)st->st_mtim.tv_sec ||
+      header.mtime_nsec != (int64_t)st->st_mtim.tv_nsec ||
+      header.size != (int64_t)st->st_size ||
+      header.inode != (uint64_t)st->st_ino) {
+    fclose(f);
+    return -1;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long total = ftell(f);
+  long body = total - (long)sizeof(header);
+  if (body <= 0) {
+    fclose(f);
+    return -1;
+  }
+
+  char *data = malloc(body);
+  if (!data) {
+    fclose(f);
+    return -1;
+  }
+  fseek(f, sizeof(header), SEEK_SET);
+  size_t read_bytes = fread(data, 1, body, f);
+  fclose(f);
+
+  int status = -1;
+  if (read_bytes == (size_t)body) {
+    if (luaL_loadbuffer(L, data, read_bytes, chunkname) == LUA_OK)
+      status = 0;
+    else
+      lua_pop(L, 1);
+  }
+  free(data);
+  return status;
+}
+
+// Writes the chunk on top of the stack to the bytecode cache. The file is
+// written under a temporary name and renamed so readers never see a partial
+// chunk.
+static void store_bytecode(lua_State *L, const char *path,
+                           const struct stat *st) {
+  DumpBuffer buf = {0};
+  if (lua_dump(L, dump_writer, &buf) != 0 || buf.len == 0) {
+    free(buf.data);
+    return;
+  }
+
+  if (validate_or_create_dir(bytecode_dir) != 0) {
+    free(buf.data);
+    return;
+  }
+
+  char tmp_path[PATH_MAX];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    free(buf.data);
+    return;
+  }
+
+  BytecodeHeader header = {BYTECODE_MAGIC, (int64_t)st->st_mtim.tv_sec,
+                           (int64_t)st->st_mtim.tv_nsec, (int64_t)st->st_size,
+                           (uint64_t)st->st_ino};
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(buf.data, 1, buf.len, f) == buf.len;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(tmp_path, path) != 0)
+    unlink(tmp_path);
+  free(buf.data);
+}
+
+// Pushes the compiled chunk for `script_path`, from the bytecode cache when it
+// is current and from source otherwise.
+static int load_chunk(lua_State *L, const char *script_path,
+                      const struct stat *st) {
+  char chunkname[PATH_MAX + 1];
+  snprintf(chunkname, sizeof(chunkname), "@%s", script_path);
+
+  char *cached = bytecode_dir ? bytecode_path(script_path) : NULL;
+  if (cached && load_cached_bytecode(L, cached, chunkname, st) == 0) {
+    free(cached);
+    return 0;
+  }
+
+  if (luaL_loadfile(L, script_path) != LUA_OK) {
+    logging(ERROR, "Failed to load Lua script: %s", lua_tostring(L, -1));
+    lua_pop(L, 1);
+    free(cached);
+    return -1;
+  }
+
+  if (cached)
+    store_bytecode(L, cached, st);
+  free(cached);
+  return 0;
+}
+
+int lua_vm_push_script(const char *script_path) {
+  lua_State *L = lua_vm_state();
+  if (!L || !script_path)
+    return -1;
+
+  struct stat st;
+  if (stat(script_path, &st) != 0) {
+    logging(ERROR, "Lua script not found: %s", script_path);
+    return -1;
+  }
+
+  char stamp[96];
+  snprintf(stamp, sizeof(stamp), "%lld.%09ld:%lld:%llu",
+           (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec,
+           (long long)st.st_size, (unsigned long long)st.st_ino);
+
+  lua_getfield(L, LUA_REGISTRYINDEX, STAMPS_KEY);
+  lua_getfield(L, -1, script_path);
+  bool current = lua_isstring(L, -1) && strcmp(lua_tostring(L, -1), stamp) == 0;
+  lua_pop(L, 2);
+
+  if (current) {
+    lua_getfield(L, LUA_REGISTRYINDEX, SCRIPTS_KEY);
+    lua_getfield(L, -1, script_path);
+    lua_remove(L, -2);
+    if (lua_istable(L, -1))
+      return 0;
+    lua_pop(L, 1);
+  }
+
+  if (load_chunk(L, script_path, &st) != 0)
+    return -1;
+
+  // env = setmetatable({}, {__index = _G})
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_setfield(L, -2, "__index");
+  lua_setmetatable(L, -2);
+  lua_pushvalue(L, -1);
+  lua_setfenv(L, -3);
+  lua_insert(L, -2);
+
+  if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+    logging(ERROR, "Failed to initialize Lua script: %s", lua_tostring(L, -1));
+    lua_pop(L, 2);
+    return -1;
+  }
+
+  lua_getfield(L, LUA_REGISTRYINDEX, SCRIPTS_KEY);
+  lua_pushvalue(L, -2);
+  lua_setfield(L, -2, script_path);
+  lua_pop(L, 1);
+
+  lua_getfield(L, LUA_REGISTRYINDEX, STAMPS_KEY);
+  lua_pushstring(L, stamp);
+  lua_setfield(L, -2, script_path);
+  lua_pop(L, 1);
+  return 0;
+}
+
+static void budget_hook(lua_State *L, lua_Debug *ar) {
+  (void)ar;
+  budget.instructions += budget.interval;
+
+  if (budget.limits.max_instructions > 0 &&
+      budget.instructions > budget.limits.max_instructions)
+    budget.exceeded = "instruction limit";
+  else if (!tracked_alloc && budget.limits.max_memory_kb > 0 &&
+           lua_gc(L, LUA_GCCOUNT, 0) - budget.memory_base_kb >
+               budget.limits.max_memory_kb)
+    budget.exceeded = "memory limit";
+
+  if (budget.exceeded)
+    luaL_error(L, "%s exceeded", budget.exceeded);
+}
+
+static volatile sig_atomic_t deadline_armed = 0;
+
+static void deadline_hook(lua_State *L, lua_Debug *ar) {
+  (void)ar;
+  budget.exceeded = "time limit";
+  luaL_error(L, "%s exceeded", budget.exceeded);
+}
+
+// lua_sethook is the one Lua call that is safe from a signal handler. The
+// hook runs at the next call, return or interpreted instruction, so the
+// deadline holds with the JIT compiler on too, except inside a compiled loop
+// that makes no calls.
+static void deadline_signal(int sig) {
+  (void)sig;
+  if (deadline_armed && vm_state)
+    lua_sethook(vm_state, deadline_hook,
+                LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT, 1);
+}
+
+static void arm_deadline(long timeout_ms) {
+  struct sigaction action = {0};
+  action.sa_handler = deadline_signal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGALRM, &action, &budget.previous_alarm) != 0)
+    return;
+
+  struct itimerval timer = {0};
+  timer.it_value.tv_sec = timeout_ms / 1000;
+  timer.it_value.tv_usec = (timeout_ms % 1000) * 1000;
+  deadline_armed = 1;
+  budget.timed = true;
+  setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+static void disarm_deadline(void) {
+  if (!budget.timed)
+    return;
+  deadline_armed = 0;
+  struct itimerval timer = {0};
+  setitimer(ITIMER_REAL, &timer, NULL);
+  sigaction(SIGALRM, &budget.previous_alarm, NULL);
+  budget.timed = false;
+}
+
+// jit.status(), which also reflects scripts calling jit.off()
+static bool jit_enabled(lua_State *L) {
+  lua_getglobal(L, "jit");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return false;
+  }
+  lua_getfield(L, -1, "status");
+  bool on = lua_isfunction(L, -1) && lua_pcall(L, 0, 1, 0) == LUA_OK &&
+            lua_toboolean(L, -1);
+  lua_pop(L, 2);
+  return on;
+}
+
+void lua_vm_begin_run(const LuaLimits *limits) {
+  lua_State *L = lua_vm_state();
+  if (!L || !limits)
+    return;
+
+  budget = (RunBudget){.limits = *limits, .active = true};
+  alloc_state.refused = false;
+  budget.memory_base_kb = lua_gc(L, LUA_GCCOUNT, 0);
+  if (tracked_alloc && limits->max_memory_kb > 0)
+    alloc_state.limit =
+        alloc_state.in_use + (size_t)limits->max_memory_kb * 1024;
+
+  bool counted = limits->max_instructions > 0 ||
+                 (!tracked_alloc && limits->max_memory_kb > 0);
+  if (counted) {
+    budget.interval = HOOK_INTERVAL;
+    if (limits->max_instructions > 0 &&
+        limits->max_instructions < budget.interval)
+      budget.interval = limits->max_instructions;
+    lua_sethook(L, budget_hook, LUA_MASKCOUNT, (int)budget.interval);
+  }
+
+  // Compiled traces skip hooks; only a run that asks for exact limits pays
+  // for the interpreter.
+  if (!limits->jit && (counted || limits->timeout_ms > 0) && jit_enabled(L)) {
+    luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_FLUSH);
+    luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+    budget.jit_disabled = true;
+  }
+
+  if (limits->timeout_ms > 0)
+    arm_deadline(limits->timeout_ms);
+}
+
+const char *lua_vm_end_run(void) {
+  if (!budget.active || !vm_state)
+    return NULL;
+  budget.active = false;
+
+  // An allocation refused by limited_alloc surfaces as a plain memory error.
+  if (!budget.exceeded && alloc_state.refused)
+    budget.exceeded = "memory limit";
+  alloc_state.limit = 0;
+  alloc_state.refused = false;
+
+  disarm_deadline();
+  lua_sethook(vm_state, NULL, 0, 0);
+  if (budget.jit_disabled)
+    luaJIT_setmode(vm_state, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+
+  if (budget.exceeded) {
+    // The script may have been stopped halfway through updating its own
+    // state; start over rather than reuse it.
+    lua_vm_close();
+  }
+  return budget.exceeded;
+}
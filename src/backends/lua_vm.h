@@ -0,0 +1,40 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "core.h"
+#include <lua.h>
+
+// One LuaJIT state shared by every script for the lifetime of the process.
+lua_State *lua_vm_state(void);
+void lua_vm_close(void);
+
+// Directory under which compiled chunks are cached (NULL disables caching).
+void lua_vm_set_cache_dir(const char *cache_dir);
+
+// Pushes the environment table of `script_path`, running the script the
+// first time (or after it changed on disk). Each script gets its own
+// environment that falls back to the shared globals. Returns 0 on success;
+// on failure nothing is pushed.
+int lua_vm_push_script(const char *script_path);
+
+// Arms the limits for the next run: a count hook enforces the instruction
+// budget, a SIGALRM timer the time budget, and the state allocator the
+// memory budget. LuaJIT does not call hooks from compiled traces, so when
+// limits->jit is off the JIT compiler is disabled for the run, and turned
+// back on after it if it was on before. Neither the hook nor the timer can
+// interrupt a blocking C call such as io.popen; the deadline is only checked
+// once it returns.
+void lua_vm_begin_run(const LuaLimits *limits);
+
+// Disarms the limits. Returns the name of the limit the run hit, or NULL.
+// After a hit the state is closed, so the next run starts from a fresh one.
+const char *lua_vm_end_run(void);
@@ -0,0 +1,422 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "cluster.h"
+#include "color_batch.h"
+#include "utils/utils.h"
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  float r, g, b;
+  double weight;
+} Centroid;
+
+#define DEDUPE_MIN_SHARE 1000 // Backfill bins hold at least 1/1000 of pixels
+
+typedef struct {
+  int start, end; // Range of bins in the working array
+  uint64_t count;
+} Box;
+
+static int sort_channel = 0;
+
+static int compare_bins(const void *a, const void *b) {
+  const ColorBin *x = a, *y = b;
+  if (x->count != y->count)
+    return (x->count < y->count) ? 1 : -1;
+  uint32_t cx = (uint32_t)x->color.red << 16 | x->color.green << 8 |
+                x->color.blue;
+  uint32_t cy = (uint32_t)y->color.red << 16 | y->color.green << 8 |
+                y->color.blue;
+  return (cx > cy) - (cx < cy);
+}
+
+static int compare_centroids(const void *a, const void *b) {
+  const Centroid *x = a, *y = b;
+  return (x->weight < y->weight) - (x->weight > y->weight);
+}
+
+static uint8_t channel_of(const Color *c, int channel) {
+  return channel == 0 ? c->red : channel == 1 ? c->green : c->blue;
+}
+
+static int compare_by_channel(const void *a, const void *b) {
+  const ColorBin *x = a, *y = b;
+  return (int)channel_of(&x->color, sort_channel) -
+         (int)channel_of(&y->color, sort_channel);
+}
+
+static float distance_sq(float r, float g, float b, const Color *c) {
+  float dr = r - c->red, dg = g - c->green, db = b - c->blue;
+  return dr * dr + dg * dg + db * db;
+}
+
+int image_histogram(const RawImage *image, int bits, ColorBin **bins) {
+  if (!image || !image->pixels || !bins || image->channels < 3)
+    return -1;
+  if (bits < HISTOGRAM_MIN_BITS)
+    bits = HISTOGRAM_MIN_BITS;
+  if (bits > HISTOGRAM_MAX_BITS)
+    bits = HISTOGRAM_MAX_BITS;
+
+  size_t num_bins = (size_t)1 << (3 * bits);
+  int shift = 8 - bits;
+  uint32_t *counts = calloc(num_bins, sizeof(uint32_t));
+  uint64_t *sums = calloc(num_bins * 3, sizeof(uint64_t));
+  if (!counts || !sums) {
+    free(counts);
+    free(sums);
+    return -1;
+  }
+
+  size_t pixels = (size_t)image->width * image->height;
+  const uint8_t *px = image->pixels;
+  for (size_t i = 0; i < pixels; i++, px += image->channels) {
+    size_t idx = (size_t)(px[0] >> shift) << (2 * bits) |
+                 (size_t)(px[1] >> shift) << bits | (px[2] >> shift);
+    counts[idx]++;
+    sums[idx * 3] += px[0];
+    sums[idx * 3 + 1] += px[1];
+    sums[idx * 3 + 2] += px[2];
+  }
+
+  int used = 0;
+  for (size_t i = 0; i < num_bins; i++)
+    used += counts[i] != 0;
+
+  ColorBin *out = malloc(sizeof(ColorBin) * (used ? used : 1));
+  if (!out) {
+    free(counts);
+    free(sums);
+    return -1;
+  }
+
+  int n = 0;
+  for (size_t i = 0; i < num_bins; i++) {
+    uint32_t c = counts[i];
+    if (!c)
+      continue;
+    out[n].color = (Color){(uint8_t)((sums[i * 3] + c / 2) / c),
+                           (uint8_t)((sums[i * 3 + 1] + c / 2) / c),
+                           (uint8_t)((sums[i * 3 + 2] + c / 2) / c)};
+    out[n].count = c;
+    n++;
+  }
+  qsort(out, n, sizeof(ColorBin), compare_bins);
+
+  free(counts);
+  free(sums);
+  *bins = out;
+  return n;
+}
+
+int kmeans_colors(const ColorBin *bins, int num_bins, int k, int iterations,
+                  Color *out) {
+  if (!bins || !out || num_bins <= 0 || k <= 0)
+    return 0;
+  if (k > num_bins)
+    k = num_bins;
+
+  Centroid *centroids = calloc(k, sizeof(Centroid));
+  Centroid *sums = calloc(k, sizeof(Centroid));
+  int *assignment = malloc(sizeof(int) * num_bins);
+  if (!centroids || !sums || !assignment) {
+    free(centroids);
+    free(sums);
+    free(assignment);
+    return 0;
+  }
+
+  // Deterministic seeding: the most populated bin, then repeatedly the bin
+  // with the largest count-weighted distance to the chosen centroids.
+  centroids[0] = (Centroid){bins[0].color.red, bins[0].color.green,
+                            bins[0].color.blue, 0};
+  for (int c = 1; c < k; c++) {
+    int best = 0;
+    float best_score = -1.0f;
+    for (int i = 0; i < num_bins; i++) {
+      float nearest = FLT_MAX;
+      for (int j = 0; j < c; j++) {
+        float d = distance_sq(centroids[j].r, centroids[j].g, centroids[j].b,
+                              &bins[i].color);
+        if (d < nearest)
+          nearest = d;
+      }
+      float score = nearest * bins[i].count;
+      if (score > best_score) {
+        best_score = score;
+        best = i;
+      }
+    }
+    centroids[c] = (Centroid){bins[best].color.red, bins[best].color.green,
+                              bins[best].color.blue, 0};
+  }
+
+  for (int i = 0; i < num_bins; i++)
+    assignment[i] = -1;
+
+  for (int iter = 0; iter < iterations; iter++) {
+    bool changed = false;
+    memset(sums, 0, sizeof(Centroid) * k);
+
+    for (int i = 0; i < num_bins; i++) {
+      int nearest = 0;
+      float nearest_d = FLT_MAX;
+      for (int c = 0; c < k; c++) {
+        float d = distance_sq(centroids[c].r, centroids[c].g, centroids[c].b,
+                              &bins[i].color);
+        if (d < nearest_d) {
+          nearest_d = d;
+          nearest = c;
+        }
+      }
+      changed |= assignment[i] != nearest;
+      assignment[i] = nearest;
+
+      double w = bins[i].count;
+      sums[nearest].r += bins[i].color.red * w;
+      sums[nearest].g += bins[i].color.green * w;
+      sums[nearest].b += bins[i].color.blue * w;
+      sums[nearest].weight += w;
+    }
+
+    for (int c = 0; c < k; c++) {
+      if (sums[c].weight > 0) {
+        centroids[c].r = sums[c].r / sums[c].weight;
+        centroids[c].g = sums[c].g / sums[c].weight;
+        centroids[c].b = sums[c].b / sums[c].weight;
+      }
+      centroids[c].weight = sums[c].weight;
+    }
+
+    if (!changed)
+      break;
+  }
+
+  qsort(centroids, k, sizeof(Centroid), compare_centroids);
+  for (int c = 0; c < k; c++)
+    out[c] = (Color){clamp_byte(centroids[c].r), clamp_byte(centroids[c].g),
+                     clamp_byte(centroids[c].b)};
+
+  free(centroids);
+  free(sums);
+  free(assignment);
+  return k;
+}
+
+static int box_longest_channel(const ColorBin *work, const Box *box,
+                               int *extent) {
+  uint8_t lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+  for (int i = box->start; i < box->end; i++) {
+    for (int ch = 0; ch < 3; ch++) {
+      uint8_t v = channel_of(&work[i].color, ch);
+      if (v < lo[ch])
+        lo[ch] = v;
+      if (v > hi[ch])
+        hi[ch] = v;
+    }
+  }
+  int channel = 0;
+  *extent = 0;
+  for (int ch = 0; ch < 3; ch++) {
+    int e = hi[ch] - lo[ch];
+    if (e > *extent) {
+      *extent = e;
+      channel = ch;
+    }
+  }
+  return channel;
+}
+
+int median_cut_colors(const ColorBin *bins, int num_bins, int k, Color *out) {
+  if (!bins || !out || num_bins <= 0 || k <= 0)
+    return 0;
+
+  ColorBin *work = malloc(sizeof(ColorBin) * num_bins);
+  Box *boxes = malloc(sizeof(Box) * k);
+  Centroid *results = malloc(sizeof(Centroid) * k);
+  if (!work || !boxes || !results) {
+    free(work);
+    free(boxes);
+    free(results);
+    return 0;
+  }
+  memcpy(work, bins, sizeof(ColorBin) * num_bins);
+
+  uint64_t total = 0;
+  for (int i = 0; i < num_bins; i++)
+    total += work[i].count;
+  boxes[0] = (Box){0, num_bins, total};
+  int num_boxes = 1;
+
+  while (num_boxes < k) {
+    // Split the box with the largest population-weighted extent.
+    int target = -1, channel = 0;
+    double best = 0.0;
+    for (int b = 0; b < num_boxes; b++) {
+      if (boxes[b].end - boxes[b].start < 2)
+        continue;
+      int extent;
+      int ch = box_longest_channel(work, &boxes[b], &extent);
+      double score = (double)extent * boxes[b].count;
+      if (extent > 0 && score > best) {
+        best = score;
+        target = b;
+        channel = ch;
+      }
+    }
+    if (target < 0)
+      break;
+
+    Box *box = &boxes[target];
+    sort_channel = channel;
+    qsort(work + box->start, box->end - box->start, sizeof(ColorBin),
+          compare_by_channel);
+
+    uint64_t half = box->count / 2, acc = 0;
+    int split = box->start + 1;
+    for (int i = box->start; i < box->end - 1; i++) {
+      acc += work[i].count;
+      split = i + 1;
+      if (acc >= half)
+        break;
+    }
+
+    uint64_t left = 0;
+    for (int i = box->start; i < split; i++)
+      left += work[i].count;
+    boxes[num_boxes++] = (Box){split, box->end, box->count - left};
+    box->end = split;
+    box->count = left;
+  }
+
+  for (int b = 0; b < num_boxes; b++) {
+    double r = 0, g = 0, bl = 0, w = 0;
+    for (int i = boxes[b].start; i < boxes[b].end; i++) {
+      r += work[i].color.red * (double)work[i].count;
+      g += work[i].color.green * (double)work[i].count;
+      bl += work[i].color.blue * (double)work[i].count;
+      w += work[i].count;
+    }
+    results[b] = (Centroid){w ? r / w : 0, w ? g / w : 0, w ? bl / w : 0, w};
+  }
+
+  qsort(results, num_boxes, sizeof(Centroid), compare_centroids);
+  for (int b = 0; b < num_boxes; b++)
+    out[b] = (Color){clamp_byte(results[b].r), clamp_byte(results[b].g),
+                     clamp_byte(results[b].b)};
+
+  free(work);
+  free(boxes);
+  free(results);
+  return num_boxes;
+}
+
+static float oklab_distance_sq(OKLab x, OKLab y) {
+  float dl = x.l - y.l, da = x.a - y.a, db = x.b - y.b;
+  return dl * dl + da * da + db * db;
+}
+
+// Marks each color within `limit` (squared) of an earlier unmarked one.
+static int mark_duplicates(const OKLab *lab, int count, float limit,
+                           bool *duplicate) {
+  int found = 0;
+  for (int i = 0; i < count; i++) {
+    duplicate[i] = false;
+    for (int j = 0; j < i && !duplicate[i]; j++) {
+      if (!duplicate[j] && oklab_distance_sq(lab[i], lab[j]) < limit)
+        duplicate[i] = true;
+    }
+    found += duplicate[i];
+  }
+  return found;
+}
+
+bool has_near_duplicates(const Color *colors, int count, float min_distance) {
+  if (!colors || count <= 1 || min_distance <= 0.0f)
+    return false;
+  if (count > PALETTE_MAX_SIZE)
+    count = PALETTE_MAX_SIZE;
+
+  OKLab lab[PALETTE_MAX_SIZE];
+  bool duplicate[PALETTE_MAX_SIZE];
+  rgb_to_oklab_batch((const uint8_t *)colors, sizeof(Color), lab, count);
+  return mark_duplicates(lab, count, min_distance * min_distance,
+                         duplicate) > 0;
+}
+
+// nearest[i] = min(nearest[i], distance from bin i to `kept`); a flat loop
+// over the bins so it vectorizes.
+static void update_nearest(const OKLab *bins, float *nearest, int num_bins,
+                           OKLab kept) {
+  for (int i = 0; i < num_bins; i++) {
+    float d = oklab_distance_sq(bins[i], kept);
+    nearest[i] = (d < nearest[i]) ? d : nearest[i];
+  }
+}
+
+int dedupe_colors(Color *colors, int count, const ColorBin *bins, int num_bins,
+                  float min_distance) {
+  if (!colors || count <= 1 || min_distance <= 0.0f)
+    return 0;
+  if (count > PALETTE_MAX_SIZE)
+    count = PALETTE_MAX_SIZE;
+
+  float limit = min_distance * min_distance;
+  OKLab lab[PALETTE_MAX_SIZE];
+  bool duplicate[PALETTE_MAX_SIZE];
+  rgb_to_oklab_batch((const uint8_t *)colors, sizeof(Color), lab, count);
+  if (mark_duplicates(lab, count, limit, duplicate) == 0 || !bins ||
+      num_bins <= 0)
+    return 0;
+
+  OKLab *bin_lab = malloc(sizeof(OKLab) * num_bins);
+  float *nearest = malloc(sizeof(float) * num_bins);
+  if (!bin_lab || !nearest) {
+    free(bin_lab);
+    free(nearest);
+    return 0;
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < num_bins; i++) {
+    total += bins[i].count;
+    nearest[i] = FLT_MAX;
+  }
+  uint64_t min_count = total / DEDUPE_MIN_SHARE;
+
+  rgb_to_oklab_batch((const uint8_t *)&bins[0].color, sizeof(ColorBin),
+                     bin_lab, num_bins);
+  for (int i = 0; i < count; i++) {
+    if (!duplicate[i])
+      update_nearest(bin_lab, nearest, num_bins, lab[i]);
+  }
+
+  // Bins are sorted by population, so the first distinct one is the best.
+  int replaced = 0;
+  for (int i = 0; i < count; i++) {
+    if (!duplicate[i])
+      continue;
+    for (int b = 0; b < num_bins && bins[b].count >= min_count; b++) {
+      if (nearest[b] >= limit) {
+        colors[i] = bins[b].color;
+        update_nearest(bin_lab, nearest, num_bins, bin_lab[b]);
+        replaced++;
+        break;
+      }
+    }
+  }
+
+  free(bin_lab);
+  free(nearest);
+  return replaced;
+}
@@ -0,0 +1,45 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "core.h"
+#include "image.h"
+#include <stddef.h>
+
+#define HISTOGRAM_MIN_BITS 2
+#define HISTOGRAM_MAX_BITS 6
+
+typedef struct {
+  Color color;    // Mean color of the pixels that fell into the bin
+  uint32_t count; // Number of pixels in the bin
+} ColorBin;
+
+// Buckets the image into 2^(3*bits) bins and returns the non-empty ones,
+// most populated first. The caller frees *bins. Returns the bin count or -1.
+int image_histogram(const RawImage *image, int bits, ColorBin **bins);
+
+// Weighted k-means over histogram bins. Writes up to k centroids, most
+// populated first, and returns how many were produced.
+int kmeans_colors(const ColorBin *bins, int num_bins, int k, int iterations,
+                  Color *out);
+
+// Median cut over histogram bins. Same output contract as kmeans_colors.
+int median_cut_colors(const ColorBin *bins, int num_bins, int k, Color *out);
+
+// True if two of the colors lie within min_distance of each other in OKLab.
+bool has_near_duplicates(const Color *colors, int count, float min_distance);
+
+// Keeps the first of each group of colors closer than min_distance in OKLab
+// and replaces the others with the most populated bins at least min_distance
+// from every kept color. Colors with no such bin are left as they are.
+// Returns the number of colors replaced.
+int dedupe_colors(Color *colors, int count, const ColorBin *bins, int num_bins,
+                  float min_distance);
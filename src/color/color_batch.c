@@ -0,0 +1,252 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "color_batch.h"
+#include "color_lanes.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  void (*rgb_to_hsl)(const uint8_t *, size_t, HSL *, size_t);
+  void (*rgb_to_hsv)(const uint8_t *, size_t, HSV *, size_t);
+  void (*rgb_to_lab)(const uint8_t *, size_t, Lab *, size_t);
+  void (*hsl_to_rgb)(const HSL *, Color *, size_t);
+  void (*hsv_to_rgb)(const HSV *, Color *, size_t);
+  void (*lab_to_rgb)(const Lab *, Color *, size_t);
+  void (*rgb_to_oklab)(const uint8_t *, size_t, OKLab *, size_t);
+  void (*oklab_to_rgb)(const OKLab *, Color *, size_t);
+} BatchKernels;
+
+static const BatchKernels *active_kernels = NULL;
+static SimdLevel active_level = SIMD_SCALAR;
+
+// Forward kernels get dedicated loops for the two common pixel strides so the
+// compiler sees constant-stride loads.
+#define FORWARD_KERNEL(name, type, lane, attr)                                 \
+  attr static void name(const uint8_t *pixels, size_t step, type *out,         \
+                        size_t count) {                                        \
+    if (step == 4) {                                                           \
+      for (size_t i = 0; i < count; i++)                                       \
+        out[i] = lane(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]);    \
+    } else if (step == 3) {                                                    \
+      for (size_t i = 0; i < count; i++)                                       \
+        out[i] = lane(pixels[i * 3], pixels[i * 3 + 1], pixels[i * 3 + 2]);    \
+    } else {                                                                   \
+      for (size_t i = 0; i < count; i++)                                       \
+        out[i] = lane(pixels[i * step], pixels[i * step + 1],                  \
+                      pixels[i * step + 2]);                                   \
+    }                                                                          \
+  }
+
+#define INVERSE_KERNEL(name, type, lane, attr)                                 \
+  attr static void name(const type *in, Color *out, size_t count) {            \
+    for (size_t i = 0; i < count; i++)                                         \
+      out[i] = lane(in[i]);                                                    \
+  }
+
+#define KERNEL_SET(isa, attr)                                                  \
+  FORWARD_KERNEL(rgb_to_hsl_##isa, HSL, lane_rgb_to_hsl, attr)                 \
+  FORWARD_KERNEL(rgb_to_hsv_##isa, HSV, lane_rgb_to_hsv, attr)                 \
+  FORWARD_KERNEL(rgb_to_lab_##isa, Lab, lane_rgb_to_lab, attr)                 \
+  INVERSE_KERNEL(hsl_to_rgb_##isa, HSL, lane_hsl_to_rgb, attr)                 \
+  INVERSE_KERNEL(hsv_to_rgb_##isa, HSV, lane_hsv_to_rgb, attr)                 \
+  INVERSE_KERNEL(lab_to_rgb_##isa, Lab, lane_lab_to_rgb, attr)                 \
+  FORWARD_KERNEL(rgb_to_oklab_##isa, OKLab, lane_rgb_to_oklab, attr)           \
+  INVERSE_KERNEL(oklab_to_rgb_##isa, OKLab, lane_oklab_to_rgb, attr)           \
+  static const BatchKernels kernels_##isa = {                                  \
+      rgb_to_hsl_##isa,   rgb_to_hsv_##isa,   rgb_to_lab_##isa,                \
+      hsl_to_rgb_##isa,   hsv_to_rgb_##isa,   lab_to_rgb_##isa,                \
+      rgb_to_oklab_##isa, oklab_to_rgb_##isa};
+
+KERNEL_SET(baseline, TARGET_SSE2)
+#if CWAL_X86
+KERNEL_SET(avx2, TARGET_AVX2)
+KERNEL_SET(avx512, TARGET_AVX512)
+#endif
+
+// Scalar reference: the per-color functions, one call per pixel.
+#define SCALAR_FORWARD_KERNEL(name, type, convert)                             \
+  static void name(const uint8_t *pixels, size_t step, type *out,              \
+                   size_t count) {                                             \
+    for (size_t i = 0; i < count; i++) {                                       \
+      const uint8_t *px = pixels + i * step;                                   \
+      out[i] = convert((Color){px[0], px[1], px[2]});                          \
+    }                                                                          \
+  }
+
+SCALAR_FORWARD_KERNEL(rgb_to_hsl_scalar, HSL, rgb_to_hsl)
+SCALAR_FORWARD_KERNEL(rgb_to_hsv_scalar, HSV, rgb_to_hsv)
+SCALAR_FORWARD_KERNEL(rgb_to_lab_scalar, Lab, rgb_to_lab)
+INVERSE_KERNEL(hsl_to_rgb_scalar, HSL, hls_to_rgb, )
+INVERSE_KERNEL(hsv_to_rgb_scalar, HSV, hsv_to_rgb, )
+INVERSE_KERNEL(lab_to_rgb_scalar, Lab, lab_to_rgb, )
+SCALAR_FORWARD_KERNEL(rgb_to_oklab_scalar, OKLab, rgb_to_oklab)
+INVERSE_KERNEL(oklab_to_rgb_scalar, OKLab, oklab_to_rgb, )
+
+static const BatchKernels kernels_scalar = {
+    rgb_to_hsl_scalar,   rgb_to_hsv_scalar,   rgb_to_lab_scalar,
+    hsl_to_rgb_scalar,   hsv_to_rgb_scalar,   lab_to_rgb_scalar,
+    rgb_to_oklab_scalar, oklab_to_rgb_scalar};
+
+#if CWAL_X86
+static const char *level_names[SIMD_LEVEL_COUNT] = {"scalar", "sse2", "avx2",
+                                                    "avx512"};
+#else
+static const char *level_names[SIMD_LEVEL_COUNT] = {"scalar", "baseline",
+                                                    "avx2", "avx512"};
+#endif
+
+static SimdLevel detect_level(void) {
+#if CWAL_X86
+  __builtin_cpu_init();
+  // Without VL, 128-bit lanes get widened to zmm, dirtying the upper state
+  // around calls into SSE code
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512vl"))
+    return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return SIMD_BASELINE;
+  return SIMD_SCALAR;
+#else
+  return SIMD_BASELINE;
+#endif
+}
+
+static const BatchKernels *select_kernels(void) {
+  if (active_kernels)
+    return active_kernels;
+
+  active_level = detect_level();
+
+  const char *requested = getenv("CWAL_SIMD");
+  if (requested) {
+    for (int i = 0; i < SIMD_LEVEL_COUNT; i++) {
+      if (strcmp(requested, level_names[i]) == 0 && (int)active_level > i) {
+        active_level = (SimdLevel)i;
+        break;
+      }
+    }
+  }
+
+  switch (active_level) {
+#if CWAL_X86
+  case SIMD_AVX512:
+    active_kernels = &kernels_avx512;
+    break;
+  case SIMD_AVX2:
+    active_kernels = &kernels_avx2;
+    break;
+#endif
+  case SIMD_SCALAR:
+    active_kernels = &kernels_scalar;
+    break;
+  default:
+    active_kernels = &kernels_baseline;
+    break;
+  }
+  return active_kernels;
+}
+
+SimdLevel color_batch_level(void) {
+  select_kernels();
+  return active_level;
+}
+
+const char *color_batch_level_name(SimdLevel level) {
+  if ((int)level < 0 || level >= SIMD_LEVEL_COUNT)
+    return "unknown";
+  return level_names[level];
+}
+
+void rgb_to_hsl_batch(const uint8_t *pixels, size_t step, HSL *out,
+                      size_t count) {
+  if (!pixels || !out || step < 3)
+    return;
+  select_kernels()->rgb_to_hsl(pixels, step, out, count);
+}
+
+void rgb_to_hsv_batch(const uint8_t *pixels, size_t step, HSV *out,
+                      size_t count) {
+  if (!pixels || !out || step < 3)
+    return;
+  select_kernels()->rgb_to_hsv(pixels, step, out, count);
+}
+
+void rgb_to_lab_batch(const uint8_t *pixels, size_t step, Lab *out,
+                      size_t count) {
+  if (!pixels || !out || step < 3)
+    return;
+  select_kernels()->rgb_to_lab(pixels, step, out, count);
+}
+
+void hsl_to_rgb_batch(const HSL *in, Color *out, size_t count) {
+  if (!in || !out)
+    return;
+  select_kernels()->hsl_to_rgb(in, out, count);
+}
+
+void hsv_to_rgb_batch(const HSV *in, Color *out, size_t count) {
+  if (!in || !out)
+    return;
+  select_kernels()->hsv_to_rgb(in, out, count);
+}
+
+void lab_to_rgb_batch(const Lab *in, Color *out, size_t count) {
+  if (!in || !out)
+    return;
+  select_kernels()->lab_to_rgb(in, out, count);
+}
+
+void rgb_to_oklab_batch(const uint8_t *pixels, size_t step, OKLab *out,
+                        size_t count) {
+  if (!pixels || !out || step < 3)
+    return;
+  select_kernels()->rgb_to_oklab(pixels, step, out, count);
+}
+
+void oklab_to_rgb_batch(const OKLab *in, Color *out, size_t count) {
+  if (!in || !out)
+    return;
+  select_kernels()->oklab_to_rgb(in, out, count);
+}
+
+static const uint8_t *image_row(const RawImage *image, int row) {
+  if (!image || !image->pixels || row < 0 || row >= image->height ||
+      image->channels < 3)
+    return NULL;
+  return image->pixels + (size_t)row * image->width * image->channels;
+}
+
+void image_row_to_hsl(const RawImage *image, int row, HSL *out) {
+  const uint8_t *pixels = image_row(image, row);
+  if (pixels)
+    rgb_to_hsl_batch(pixels, image->channels, out, image->width);
+}
+
+void image_row_to_hsv(const RawImage *image, int row, HSV *out) {
+  const uint8_t *pixels = image_row(image, row);
+  if (pixels)
+    rgb_to_hsv_batch(pixels, image->channels, out, image->width);
+}
+
+void image_row_to_lab(const RawImage *image, int row, Lab *out) {
+  const uint8_t *pixels = image_row(image, row);
+  if (pixels)
+    rgb_to_lab_batch(pixels, image->channels, out, image->width);
+}
+
+void image_row_to_oklab(const RawImage *image, int row, OKLab *out) {
+  const uint8_t *pixels = image_row(image, row);
+  if (pixels)
+    rgb_to_oklab_batch(pixels, image->channels, out, image->width);
+}
@@ -0,0 +1,51 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "color_conversion.h"
+#include "core.h"
+#include "image.h"
+#include "oklab.h"
+#include <stddef.h>
+
+// Kernel variants, selected once at runtime from the CPU features.
+// CWAL_SIMD=scalar|sse2|avx2|avx512 caps the selection.
+typedef enum {
+  SIMD_SCALAR,   // Per-color reference functions from color_conversion.c
+  SIMD_BASELINE, // Branch-free kernels for the base ISA (SSE2 on x86)
+  SIMD_AVX2,
+  SIMD_AVX512,
+  SIMD_LEVEL_COUNT
+} SimdLevel;
+
+SimdLevel color_batch_level(void);
+const char *color_batch_level_name(SimdLevel level);
+
+// `pixels` holds `count` pixels of `step` bytes each (3 for Color arrays,
+// 4 for RawImage RGBA buffers); only the first three bytes are read.
+void rgb_to_hsl_batch(const uint8_t *pixels, size_t step, HSL *out,
+                      size_t count);
+void rgb_to_hsv_batch(const uint8_t *pixels, size_t step, HSV *out,
+                      size_t count);
+void rgb_to_lab_batch(const uint8_t *pixels, size_t step, Lab *out,
+                      size_t count);
+void hsl_to_rgb_batch(const HSL *in, Color *out, size_t count);
+void hsv_to_rgb_batch(const HSV *in, Color *out, size_t count);
+void lab_to_rgb_batch(const Lab *in, Color *out, size_t count);
+void rgb_to_oklab_batch(const uint8_t *pixels, size_t step, OKLab *out,
+                        size_t count);
+void oklab_to_rgb_batch(const OKLab *in, Color *out, size_t count);
+
+// Converts one row of a RawImage; `out` must hold image->width entries.
+void image_row_to_hsl(const RawImage *image, int row, HSL *out);
+void image_row_to_hsv(const RawImage *image, int row, HSV *out);
+void image_row_to_lab(const RawImage *image, int row, Lab *out);
+void image_row_to_oklab(const RawImage *image, int row, OKLab *out);
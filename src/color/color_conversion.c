@@ -9,9 +9,15 @@
  */
 
 #include "color_conversion.h"
+#include "color_lut.h"
 #include "utils/utils.h"
 #include <math.h>
 
+#define D65_X 0.95047f
+#define D65_Z 1.08883f
+#define LAB_EPSILON (216.0f / 24389.0f)
+#define LAB_SLOPE (108.0f / 841.0f)
+
 HSL rgb_to_hsl(Color clr) {
   float r = clr.red / 255.0f;
   float g = clr.green / 255.0f;
@@ -118,61 +124,118 @@ HSV rgb_to_hsv(Color c) {
   return hsv;
 }
 
-Color hsv_to_rgb(HSV hsv) {
-  float h = hsv.h, s = hsv.s, v = hsv.v;
+void hsv_value_factors(float h, float s, float factors[3]) {
   float r, g, b;
 
   if (s == 0.0f) {
-    r = g = b = v;
+    r = g = b = 1.0f;
   } else {
     h /= 60.0f;
     int i = (int)h;
     float f = h - i;
-    float p = v * (1.0f - s);
-    float q = v * (1.0f - s * f);
-    float t = v * (1.0f - s * (1.0f - f));
+    float p = 1.0f - s;
+    float q = 1.0f - s * f;
+    float t = 1.0f - s * (1.0f - f);
 
     switch (i) {
     case 0:
-      r = v;
+      r = 1.0f;
       g = t;
       b = p;
       break;
     case 1:
       r = q;
-      g = v;
+      g = 1.0f;
       b = p;
       break;
     case 2:
       r = p;
-      g = v;
+      g = 1.0f;
       b = t;
       break;
     case 3:
       r = p;
       g = q;
-      b = v;
+      b = 1.0f;
       break;
     case 4:
       r = t;
       g = p;
-      b = v;
+      b = 1.0f;
       break;
     case 5:
-      r = v;
+      r = 1.0f;
       g = p;
       b = q;
       break;
     default:
-      r = g = b = 0;
+      r = g = b = 0.0f;
       break;
     }
   }
 
+  factors[0] = r;
+  factors[1] = g;
+  factors[2] = b;
+}
+
+Color hsv_to_rgb(HSV hsv) {
+  float factors[3];
+  hsv_value_factors(hsv.h, hsv.s, factors);
+
   Color color = {
-      .red = clamp_byte(r * 255.0f),
-      .green = clamp_byte(g * 255.0f),
-      .blue = clamp_byte(b * 255.0f),
+      .red = clamp_byte(hsv.v * factors[0] * 255.0f),
+      .green = clamp_byte(hsv.v * factors[1] * 255.0f),
+      .blue = clamp_byte(hsv.v * factors[2] * 255.0f),
+  };
+  return color;
+}
+
+static float linear_to_srgb(float c) {
+  return (c <= 0.0031308f) ? c * 12.92f
+                           : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static float lab_f(float t) {
+  return (t > LAB_EPSILON) ? cbrtf(t) : t / LAB_SLOPE + 4.0f / 29.0f;
+}
+
+static float lab_f_inv(float t) {
+  return (t > 6.0f / 29.0f) ? t * t * t : (t - 4.0f / 29.0f) * LAB_SLOPE;
+}
+
+Lab rgb_to_lab(Color clr) {
+  float r = srgb_to_linear_lut[clr.red];
+  float g = srgb_to_linear_lut[clr.green];
+  float b = srgb_to_linear_lut[clr.blue];
+
+  float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / D65_X;
+  float y = 0.2126729f * r + 0.7151522f * g + 0.0721750f * b;
+  float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / D65_Z;
+
+  float fx = lab_f(x), fy = lab_f(y), fz = lab_f(z);
+
+  Lab lab = {116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz)};
+  return lab;
+}
+
+Color lab_to_rgb(Lab lab) {
+  float fy = (lab.l + 16.0f) / 116.0f;
+  float fx = fy + lab.a / 500.0f;
+  float fz = fy - lab.b / 200.0f;
+
+  float x = lab_f_inv(fx) * D65_X;
+  float y = lab_f_inv(fy);
+  float z = lab_f_inv(fz) * D65_Z;
+
+  float r = 3.2404542f * x - 1.5371385f * y - 0.4985314f * z;
+  float g = -0.9692660f * x + 1.8760108f * y + 0.0415560f * z;
+  float b = 0.0556434f * x - 0.2040259f * y + 1.0572252f * z;
+
+  Color color = {
+      .red = clamp_byte(linear_to_srgb(clamp_value(r)) * 255.0f),
+      .green = clamp_byte(linear_to_srgb(clamp_value(g)) * 255.0f),
+      .blue = clamp_byte(linear_to_srgb(clamp_value(b)) * 255.0f),
   };
   return color;
 }
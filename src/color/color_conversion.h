@@ -20,7 +20,17 @@ typedef struct {
   float h, s, v;
 } HSV;
 
+// CIE L*a*b* relative to the D65 white point.
+typedef struct {
+  float l, a, b;
+} Lab;
+
 HSL rgb_to_hsl(Color clr);
 Color hls_to_rgb(HSL hls);
 HSV rgb_to_hsv(Color clr);
 Color hsv_to_rgb(HSV hsv);
+// Each channel of hsv_to_rgb is v times a factor that depends only on hue
+// and saturation; callers varying v alone can compute these once.
+void hsv_value_factors(float h, float s, float factors[3]);
+Lab rgb_to_lab(Color clr);
+Color lab_to_rgb(Lab lab);
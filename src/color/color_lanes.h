@@ -0,0 +1,510 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "color_conversion.h"
+#include "color_lut.h"
+#include "oklab.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-color helpers shared by the batch kernels in src/color. They mirror the
+// scalar functions in color_conversion.c bit for bit, with the branches
+// rewritten as selects so loops calling them auto-vectorize.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CWAL_X86 1
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512vl")))
+#else
+#define CWAL_X86 0
+#define TARGET_SSE2
+#endif
+
+#define LANE static inline __attribute__((always_inline))
+
+#define D65_X 0.95047f
+#define D65_Z 1.08883f
+#define LAB_EPSILON (216.0f / 24389.0f)
+#define LAB_SLOPE (108.0f / 841.0f)
+
+LANE uint8_t lane_byte(float value) {
+  value = (value < 0.0f) ? 0.0f : value;
+  value = (value > 255.0f) ? 255.0f : value;
+  return (uint8_t)(value + 0.5f);
+}
+
+LANE float lane_max(float a, float b) { return (a > b) ? a : b; }
+
+LANE float lane_min(float a, float b) { return (a < b) ? a : b; }
+
+LANE float lane_frac(float x) { return x - (float)(int)x; }
+
+LANE HSL lane_rgb_to_hsl(uint8_t red, uint8_t green, uint8_t blue) {
+  float r = red / 255.0f;
+  float g = green / 255.0f;
+  float b = blue / 255.0f;
+
+  float max = lane_max(lane_max(r, g), b);
+  float min = lane_min(lane_min(r, g), b);
+  float sum = max + min;
+  float range = max - min;
+  bool gray = range == 0.0f;
+  float safe_range = gray ? 1.0f : range;
+
+  float l = sum / 2.0f;
+  float s = (l <= 0.5f) ? (safe_range / (gray ? 1.0f : sum))
+                        : (safe_range / (2.0f - sum));
+
+  float h = (r == max)   ? (g - b) / safe_range
+            : (g == max) ? 2.0f + (b - r) / safe_range
+                         : 4.0f + (r - g) / safe_range;
+  h = h / 6.0f;
+  h = (h < 0.0f) ? h + 1.0f : h;
+
+  HSL hsl = {gray ? 0.0f : h, l, gray ? 0.0f : s};
+  return hsl;
+}
+
+LANE HSV lane_rgb_to_hsv(uint8_t red, uint8_t green, uint8_t blue) {
+  float r = red / 255.0f;
+  float g = green / 255.0f;
+  float b = blue / 255.0f;
+
+  float max = lane_max(r, lane_max(g, b));
+  float min = lane_min(r, lane_min(g, b));
+  float delta = max - min;
+  bool gray = delta < 0.00001f;
+  float safe_delta = gray ? 1.0f : delta;
+
+  float s = safe_delta / (gray ? 1.0f : max);
+  float h = (r >= max)   ? (g - b) / safe_delta
+            : (g >= max) ? 2.0f + (b - r) / safe_delta
+                         : 4.0f + (r - g) / safe_delta;
+  h *= 60.0f;
+  h = (h < 0.0f) ? h + 360.0f : h;
+
+  HSV hsv = {gray ? 0.0f : h, gray ? 0.0f : s, max};
+  return hsv;
+}
+
+// Cube root via the exponent-divide-by-three guess and three Newton steps.
+// Exact to float precision for the (LAB_EPSILON, 1.1] range it is used on.
+LANE float lane_cbrt(float t) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = t};
+  bits.u = bits.u / 3 + 709921077u;
+  float y = bits.f;
+  y = (2.0f * y + t / (y * y)) / 3.0f;
+  y = (2.0f * y + t / (y * y)) / 3.0f;
+  y = (2.0f * y + t / (y * y)) / 3.0f;
+  return y;
+}
+
+LANE float lane_lab_f(float t) {
+  float safe = (t > LAB_EPSILON) ? t : 1.0f;
+  return (t > LAB_EPSILON) ? lane_cbrt(safe) : t / LAB_SLOPE + 4.0f / 29.0f;
+}
+
+LANE float lane_lab_f_inv(float t) {
+  return (t > 6.0f / 29.0f) ? t * t * t : (t - 4.0f / 29.0f) * LAB_SLOPE;
+}
+
+LANE Lab lane_rgb_to_lab(uint8_t red, uint8_t green, uint8_t blue) {
+  float r = srgb_to_linear_lut[red];
+  float g = srgb_to_linear_lut[green];
+  float b = srgb_to_linear_lut[blue];
+
+  float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / D65_X;
+  float y = 0.2126729f * r + 0.7151522f * g + 0.0721750f * b;
+  float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / D65_Z;
+
+  float fx = lane_lab_f(x), fy = lane_lab_f(y), fz = lane_lab_f(z);
+
+  Lab lab = {116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz)};
+  return lab;
+}
+
+LANE float lane_hue_channel(float t, float temp1, float temp2) {
+  return (6.0f * t < 1.0f)   ? temp2 + (temp1 - temp2) * 6.0f * t
+         : (2.0f * t < 1.0f) ? temp1
+         : (3.0f * t < 2.0f) ? temp2 + (temp1 - temp2) * (2.0f / 3.0f - t) * 6.0f
+                             : temp2;
+}
+
+LANE Color lane_hsl_to_rgb(HSL hls) {
+  float h = hls.h, s = hls.s, l = hls.l;
+
+  float temp1 = (l < 0.5f) ? (l * (1.0f + s)) : (l + s - l * s);
+  float temp2 = 2.0f * l - temp1;
+
+  float tempr = lane_frac(h + 1.0f / 3.0f);
+  float tempg = h;
+  float tempb = lane_frac(h - 1.0f / 3.0f + 1.0f);
+
+  float r = lane_hue_channel(tempr, temp1, temp2);
+  float g = lane_hue_channel(tempg, temp1, temp2);
+  float b = lane_hue_channel(tempb, temp1, temp2);
+
+  bool gray = s == 0.0f;
+  Color color = {
+      .red = lane_byte((gray ? l : r) * 255.0f),
+      .green = lane_byte((gray ? l : g) * 255.0f),
+      .blue = lane_byte((gray ? l : b) * 255.0f),
+  };
+  return color;
+}
+
+LANE Color lane_hsv_to_rgb(HSV hsv) {
+  float h = hsv.h / 60.0f, s = hsv.s, v = hsv.v;
+  int i = (int)h;
+  float f = h - i;
+  float p = v * (1.0f - s);
+  float q = v * (1.0f - s * f);
+  float t = v * (1.0f - s * (1.0f - f));
+
+  float r = (i == 0 || i == 5) ? v : (i == 1) ? q : (i == 4) ? t : p;
+  float g = (i == 1 || i == 2) ? v : (i == 0) ? t : (i == 3) ? q : p;
+  float b = (i == 3 || i == 4) ? v : (i == 2) ? t : (i == 5) ? q : p;
+
+  bool valid = i >= 0 && i <= 5;
+  bool gray = s == 0.0f;
+  Color color = {
+      .red = lane_byte((gray ? v : valid ? r : 0.0f) * 255.0f),
+      .green = lane_byte((gray ? v : valid ? g : 0.0f) * 255.0f),
+      .blue = lane_byte((gray ? v : valid ? b : 0.0f) * 255.0f),
+  };
+  return color;
+}
+
+// Rounds linear light to the nearest sRGB byte. The 12-bit table is never
+// more than one byte off, so one midpoint comparison each way makes it exact.
+LANE uint8_t lane_linear_to_byte(float value) {
+  float clamped = lane_min(lane_max(value, 0.0f), 1.0f);
+  int pos = linear_to_srgb_lut[(int)(clamped * LINEAR_LUT_SIZE)];
+  int below = (pos > 0) ? pos - 1 : 0;
+  pos -= (pos > 0 && value < srgb_midpoints_lut[below]) ? 1 : 0;
+  pos += (srgb_midpoints_lut[pos] <= value) ? 1 : 0;
+  return (uint8_t)pos;
+}
+
+LANE Color lane_lab_to_rgb(Lab lab) {
+  float fy = (lab.l + 16.0f) / 116.0f;
+  float fx = fy + lab.a / 500.0f;
+  float fz = fy - lab.b / 200.0f;
+
+  float x = lane_lab_f_inv(fx) * D65_X;
+  float y = lane_lab_f_inv(fy);
+  float z = lane_lab_f_inv(fz) * D65_Z;
+
+  Color color = {
+      .red = lane_linear_to_byte(3.2404542f * x - 1.5371385f * y -
+                                 0.4985314f * z),
+      .green = lane_linear_to_byte(-0.9692660f * x + 1.8760108f * y +
+                                   0.0415560f * z),
+      .blue = lane_linear_to_byte(0.0556434f * x - 0.2040259f * y +
+                                  1.0572252f * z),
+  };
+  return color;
+}
+
+LANE float lane_cbrt_or_zero(float t) {
+  return (t > 0.0f) ? lane_cbrt((t > 0.0f) ? t : 1.0f) : 0.0f;
+}
+
+LANE OKLab lane_rgb_to_oklab(uint8_t red, uint8_t green, uint8_t blue) {
+  float r = srgb_to_linear_lut[red];
+  float g = srgb_to_linear_lut[green];
+  float b = srgb_to_linear_lut[blue];
+
+  float l = lane_cbrt_or_zero(0.4122214708f * r + 0.5363325363f * g +
+                              0.0514459929f * b);
+  float m = lane_cbrt_or_zero(0.2119034982f * r + 0.6806995451f * g +
+                              0.1073969566f * b);
+  float s = lane_cbrt_or_zero(0.0883024619f * r + 0.2817188376f * g +
+                              0.6299787005f * b);
+
+  OKLab lab = {
+      0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+      1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+      0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s,
+  };
+  return lab;
+}
+
+LANE Color lane_oklab_to_rgb(OKLab lab) {
+  float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+  float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+  float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+  l = l * l * l;
+  m = m * m * m;
+  s = s * s * s;
+
+  Color color = {
+      .red = lane_linear_to_byte(4.0767416621f * l - 3.3077115913f * m +
+                                 0.2309699292f * s),
+      .green = lane_linear_to_byte(-1.2684380046f * l + 2.6097574011f * m -
+                                   0.3413193965f * s),
+      .blue = lane_linear_to_byte(-0.0041960863f * l - 0.7034186147f * m +
+                                  1.7076147010f * s),
+  };
+  return color;
+}
+
+// Explicit vectors of VECTOR_WIDTH lanes, for code too branchy for the
+// auto-vectorizer. Same operations in the same order as the helpers above;
+// comparisons yield all-ones masks and every branch is a vselect.
+
+#define VECTOR_WIDTH 4 // 128-bit: native on SSE2 and NEON, no ABI changes
+
+typedef float vfloat __attribute__((vector_size(VECTOR_WIDTH * sizeof(float))));
+typedef int32_t vint
+    __attribute__((vector_size(VECTOR_WIDTH * sizeof(int32_t))));
+
+typedef struct {
+  vint red, green, blue; // 0..255
+} VColor;
+
+typedef struct {
+  vfloat h, l, s;
+} VHSL;
+
+typedef struct {
+  vfloat h, s, v;
+} VHSV;
+
+LANE vfloat vsplat(float value) { return (vfloat){0} + value; }
+
+LANE vint vsplati(int32_t value) { return (vint){0} + value; }
+
+LANE vfloat vselect(vint mask, vfloat a, vfloat b) {
+  return (vfloat)((mask & (vint)a) | (~mask & (vint)b));
+}
+
+LANE vint vselecti(vint mask, vint a, vint b) {
+  return (mask & a) | (~mask & b);
+}
+
+LANE VColor vselect_color(vint mask, VColor a, VColor b) {
+  VColor color = {vselecti(mask, a.red, b.red),
+                  vselecti(mask, a.green, b.green),
+                  vselecti(mask, a.blue, b.blue)};
+  return color;
+}
+
+LANE bool vany(vint mask) {
+  int32_t any = 0;
+  for (int i = 0; i < VECTOR_WIDTH; i++)
+    any |= mask[i];
+  return any != 0;
+}
+
+LANE vfloat vto_float(vint value) {
+  return __builtin_convertvector(value, vfloat);
+}
+
+LANE vint vtrunc(vfloat value) { return __builtin_convertvector(value, vint); }
+
+LANE vfloat vmax(vfloat a, vfloat b) { return vselect(a > b, a, b); }
+
+LANE vfloat vmin(vfloat a, vfloat b) { return vselect(a < b, a, b); }
+
+LANE vint vmaxi(vint a, vint b) { return vselecti(a > b, a, b); }
+
+LANE vint vmini(vint a, vint b) { return vselecti(a < b, a, b); }
+
+LANE vfloat vfrac(vfloat x) { return x - vto_float(vtrunc(x)); }
+
+LANE vfloat vclamp(vfloat value) {
+  value = vselect(value < 0.0f, vsplat(0.0f), value);
+  return vselect(value > 1.0f, vsplat(1.0f), value);
+}
+
+LANE vint vbyte(vfloat value) {
+  value = vselect(value < 0.0f, vsplat(0.0f), value);
+  value = vselect(value > 255.0f, vsplat(255.0f), value);
+  return vtrunc(value + 0.5f);
+}
+
+LANE VHSL vrgb_to_hsl(VColor color) {
+  vfloat r = vto_float(color.red) / 255.0f;
+  vfloat g = vto_float(color.green) / 255.0f;
+  vfloat b = vto_float(color.blue) / 255.0f;
+
+  vfloat max = vmax(vmax(r, g), b);
+  vfloat min = vmin(vmin(r, g), b);
+  vfloat sum = max + min;
+  vfloat range = max - min;
+  vint gray = range == 0.0f;
+  vfloat safe_range = vselect(gray, vsplat(1.0f), range);
+
+  vfloat l = sum / 2.0f;
+  vfloat s = vselect(l <= 0.5f, safe_range / vselect(gray, vsplat(1.0f), sum),
+                     safe_range / (2.0f - sum));
+
+  vfloat h = vselect(r == max, (g - b) / safe_range,
+                     vselect(g == max, 2.0f + (b - r) / safe_range,
+                             4.0f + (r - g) / safe_range));
+  h = h / 6.0f;
+  h = vselect(h < 0.0f, h + 1.0f, h);
+
+  VHSL hsl = {vselect(gray, vsplat(0.0f), h), l,
+              vselect(gray, vsplat(0.0f), s)};
+  return hsl;
+}
+
+LANE VHSV vrgb_to_hsv(VColor color) {
+  vfloat r = vto_float(color.red) / 255.0f;
+  vfloat g = vto_float(color.green) / 255.0f;
+  vfloat b = vto_float(color.blue) / 255.0f;
+
+  vfloat max = vmax(r, vmax(g, b));
+  vfloat min = vmin(r, vmin(g, b));
+  vfloat delta = max - min;
+  vint gray = delta < 0.00001f;
+  vfloat safe_delta = vselect(gray, vsplat(1.0f), delta);
+
+  vfloat s = safe_delta / vselect(gray, vsplat(1.0f), max);
+  vfloat h = vselect(r >= max, (g - b) / safe_delta,
+                     vselect(g >= max, 2.0f + (b - r) / safe_delta,
+                             4.0f + (r - g) / safe_delta));
+  h *= 60.0f;
+  h = vselect(h < 0.0f, h + 360.0f, h);
+
+  VHSV hsv = {vselect(gray, vsplat(0.0f), h), vselect(gray, vsplat(0.0f), s),
+              max};
+  return hsv;
+}
+
+LANE vfloat vhue_channel(vfloat t, vfloat temp1, vfloat temp2) {
+  return vselect(
+      6.0f * t < 1.0f, temp2 + (temp1 - temp2) * 6.0f * t,
+      vselect(2.0f * t < 1.0f, temp1,
+              vselect(3.0f * t < 2.0f,
+                      temp2 + (temp1 - temp2) * (2.0f / 3.0f - t) * 6.0f,
+                      temp2)));
+}
+
+LANE VColor vhsl_to_rgb(VHSL hls) {
+  vfloat h = hls.h, s = hls.s, l = hls.l;
+
+  vfloat temp1 = vselect(l < 0.5f, l * (1.0f + s), l + s - l * s);
+  vfloat temp2 = 2.0f * l - temp1;
+
+  vfloat r = vhue_channel(vfrac(h + 1.0f / 3.0f), temp1, temp2);
+  vfloat g = vhue_channel(h, temp1, temp2);
+  vfloat b = vhue_channel(vfrac(h - 1.0f / 3.0f + 1.0f), temp1, temp2);
+
+  vint gray = s == 0.0f;
+  VColor color = {vbyte(vselect(gray, l, r) * 255.0f),
+                  vbyte(vselect(gray, l, g) * 255.0f),
+                  vbyte(vselect(gray, l, b) * 255.0f)};
+  return color;
+}
+
+// hsv_value_factors for every lane
+LANE void vhsv_value_factors(vfloat h, vfloat s, vfloat factors[3]) {
+  h = h / 60.0f;
+  vint i = vtrunc(h);
+  vfloat f = h - vto_float(i);
+  vfloat one = vsplat(1.0f);
+  vfloat p = 1.0f - s;
+  vfloat q = 1.0f - s * f;
+  vfloat t = 1.0f - s * (1.0f - f);
+
+  vfloat r = vselect((i == 0) | (i == 5), one,
+                     vselect(i == 1, q, vselect(i == 4, t, p)));
+  vfloat g = vselect((i == 1) | (i == 2), one,
+                     vselect(i == 0, t, vselect(i == 3, q, p)));
+  vfloat b = vselect((i == 3) | (i == 4), one,
+                     vselect(i == 2, t, vselect(i == 5, q, p)));
+
+  vint valid = (i >= 0) & (i <= 5);
+  vint gray = s == 0.0f;
+  vfloat zero = vsplat(0.0f);
+  factors[0] = vselect(gray, one, vselect(valid, r, zero));
+  factors[1] = vselect(gray, one, vselect(valid, g, zero));
+  factors[2] = vselect(gray, one, vselect(valid, b, zero));
+}
+
+LANE VColor vhsv_to_rgb(VHSV hsv) {
+  vfloat factors[3];
+  vhsv_value_factors(hsv.h, hsv.s, factors);
+  VColor color = {vbyte(hsv.v * factors[0] * 255.0f),
+                  vbyte(hsv.v * factors[1] * 255.0f),
+                  vbyte(hsv.v * factors[2] * 255.0f)};
+  return color;
+}
+
+LANE vfloat vluminance(VColor color) {
+  vfloat r, g, b;
+  for (int i = 0; i < VECTOR_WIDTH; i++) {
+    r[i] = srgb_to_linear_lut[color.red[i]];
+    g[i] = srgb_to_linear_lut[color.green[i]];
+    b[i] = srgb_to_linear_lut[color.blue[i]];
+  }
+  return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+// Q16 amount of darken_color and lighten_color
+LANE vint vamount_q16(vfloat amount) {
+  return vtrunc(vclamp(amount) * 65536.0f + 0.5f);
+}
+
+LANE VColor vdarken(VColor color, vfloat amount) {
+  vint keep = 65536 - vamount_q16(amount);
+  VColor result = {(color.red * keep) >> 16, (color.green * keep) >> 16,
+                   (color.blue * keep) >> 16};
+  return result;
+}
+
+LANE VColor vlighten(VColor color, vfloat amount) {
+  vint a = vamount_q16(amount);
+  VColor result = {color.red + (((255 - color.red) * a) >> 16),
+                   color.green + (((255 - color.green) * a) >> 16),
+                   color.blue + (((255 - color.blue) * a) >> 16)};
+  return result;
+}
+
+// saturate_color for every lane, in the same Q8 integer math
+LANE VColor vsaturate(VColor color, vfloat amount) {
+  vint max = vmaxi(vmaxi(color.red, color.green), color.blue);
+  vint min = vmini(vmini(color.red, color.green), color.blue);
+  vint sum = max + min;
+  vint range = max - min;
+  vint span = vselecti(sum > 255, 510 - sum, sum);
+  vint flat = span == 0;
+  vint gray = range == 0;
+
+  amount = vmax(vsplat(-1.0f), vmin(amount, vsplat(1.0f)));
+  vint shift = vtrunc(amount * 65536.0f +
+                      vselect(amount < 0.0f, vsplat(-0.5f), vsplat(0.5f)));
+  vint chroma = range * 256 + ((shift * span + 128) >> 8);
+  chroma = vmaxi(chroma, vsplati(0));
+  chroma = vmini(chroma, span * 256);
+
+  vint safe_range = vselecti(gray, vsplati(1), range);
+  vint channels[3] = {color.red, color.green, color.blue};
+  vint out[3];
+  for (int i = 0; i < 3; i++) {
+    vint toward = (i == 0) ? chroma : -chroma;
+    vint offset = vselecti(gray, toward,
+                           (2 * channels[i] - sum) * chroma / safe_range);
+    vint value = (sum * 256 + offset + 256) >> 9;
+    value = vmini(vmaxi(value, vsplati(0)), vsplati(255));
+    out[i] = vselecti(flat, channels[i], value);
+  }
+  VColor result = {out[0], out[1], out[2]};
+  return result;
+}
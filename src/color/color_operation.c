@@ -10,68 +10,178 @@
 
 #include "color_operation.h"
 #include "color_conversion.h"
+#include "color_lut.h"
 #include "utils/utils.h"
 #include <math.h>
+#include <stdlib.h>
+
+#define Q16_ONE 65536
+
+static uint32_t amount_q16(float amount) {
+  return (uint32_t)(clamp_value(amount) * Q16_ONE + 0.5f);
+}
 
 Color darken_color(Color clr, float amount) {
-  amount = clamp_value(amount);
+  uint32_t keep = Q16_ONE - amount_q16(amount);
   return (Color){
-      .red = (uint8_t)(clr.red * (1.0f - amount)),
-      .green = (uint8_t)(clr.green * (1.0f - amount)),
-      .blue = (uint8_t)(clr.blue * (1.0f - amount)),
+      .red = (uint8_t)((clr.red * keep) >> 16),
+      .green = (uint8_t)((clr.green * keep) >> 16),
+      .blue = (uint8_t)((clr.blue * keep) >> 16),
   };
 }
 
 Color lighten_color(Color clr, float amount) {
-  amount = clamp_value(amount);
+  uint32_t a = amount_q16(amount);
   return (Color){
-      .red = (uint8_t)(clr.red + (255 - clr.red) * amount),
-      .green = (uint8_t)(clr.green + (255 - clr.green) * amount),
-      .blue = (uint8_t)(clr.blue + (255 - clr.blue) * amount),
+      .red = (uint8_t)(clr.red + (((255 - clr.red) * a) >> 16)),
+      .green = (uint8_t)(clr.green + (((255 - clr.green) * a) >> 16)),
+      .blue = (uint8_t)(clr.blue + (((255 - clr.blue) * a) >> 16)),
   };
 }
 
+// With hue and lightness fixed, each channel's distance from the lightness is
+// proportional to HSL saturation, so the channels are rescaled around it in
+// Q8 integer math instead of converting to HSL and back.
 Color saturate_color(Color clr, float amount) {
-  HSL hsl = rgb_to_hsl(clr);
-  hsl.s = clamp_value(hsl.s + amount);
-  Color result = hls_to_rgb(hsl);
-  return result;
+  int max = clr.red, min = clr.red;
+  if (clr.green > max)
+    max = clr.green;
+  if (clr.blue > max)
+    max = clr.blue;
+  if (clr.green < min)
+    min = clr.green;
+  if (clr.blue < min)
+    min = clr.blue;
+
+  int sum = max + min;             // 2 * lightness * 255
+  int range = max - min;           // chroma * 255
+  int span = 255 - abs(sum - 255); // chroma of a fully saturated color
+  if (span == 0)
+    return clr; // Black or white
+
+  // New chroma in Q8: saturation moves by `amount`, which is chroma / span
+  amount = fmaxf(-1.0f, fminf(amount, 1.0f));
+  int shift = (int)(amount * Q16_ONE + (amount < 0.0f ? -0.5f : 0.5f));
+  int chroma = range * 256 + ((shift * span + 128) >> 8);
+  if (chroma < 0)
+    chroma = 0;
+  if (chroma > span * 256)
+    chroma = span * 256;
+
+  int channels[3] = {clr.red, clr.green, clr.blue};
+  int out[3];
+  for (int i = 0; i < 3; i++) {
+    // Grays have hue 0 in rgb_to_hsl, so they saturate toward red.
+    int offset;
+    if (range == 0)
+      offset = (i == 0) ? chroma : -chroma;
+    else
+      offset = (2 * channels[i] - sum) * chroma / range;
+    int value = (sum * 256 + offset + 256) >> 9; // Rounded half of 2 * channel
+    out[i] = value < 0 ? 0 : value > 255 ? 255 : value;
+  }
+  return (Color){(uint8_t)out[0], (uint8_t)out[1], (uint8_t)out[2]};
 }
 
 float w3_luminance(Color clr) {
-  float channels[3] = {clr.red / 255.0f, clr.green / 255.0f, clr.blue / 255.0f};
+  return 0.2126f * srgb_to_linear_lut[clr.red] +
+         0.7152f * srgb_to_linear_lut[clr.green] +
+         0.0722f * srgb_to_linear_lut[clr.blue];
+}
 
-  for (int i = 0; i < 3; ++i) {
-    channels[i] = (channels[i] <= 0.04045f)
-                      ? channels[i] / 12.92f
-                      : powf((channels[i] + 0.055f) / 1.055f, 2.4f);
-  }
+// WCAG contrast ratio between two colors, from 1 to 21
+float contrast_ratio(Color a, Color b) {
+  float lum_a = w3_luminance(a);
+  float lum_b = w3_luminance(b);
+  return (fmaxf(lum_a, lum_b) + 0.05f) / (fminf(lum_a, lum_b) + 0.05f);
+}
 
-  return 0.2126f * channels[0] + 0.7152f * channels[1] + 0.0722f * channels[2];
+// hsv_to_rgb at value v from hsv_value_factors; v and the factors are within
+// 0..1, so the products need no clamping.
+static Color scale_value(const float factors[3], float v) {
+  return (Color){
+      .red = (uint8_t)(v * factors[0] * 255.0f + 0.5f),
+      .green = (uint8_t)(v * factors[1] * 255.0f + 0.5f),
+      .blue = (uint8_t)(v * factors[2] * 255.0f + 0.5f),
+  };
 }
 
-Color binary_luminance_adjust(float luminance_desired, float hue, float s_min,
-                              float s_max, float v_min, float v_max,
-                              int iterations) {
-  HSV result = {hue, (s_min + s_max) / 2, (v_min + v_max) / 2};
+// True when no color of the curve lies between lo and hi: each channel that
+// changes steps by one, and all of them step at the same v.
+static bool adjacent(Color lo, Color hi, const float factors[3]) {
+  uint8_t low[3] = {lo.red, lo.green, lo.blue};
+  uint8_t high[3] = {hi.red, hi.green, hi.blue};
+  int changed = -1;
+  for (int i = 0; i < 3; i++) {
+    if (high[i] == low[i])
+      continue;
+    if (high[i] - low[i] > 1)
+      return false;
+    if (changed >= 0 &&
+        (factors[i] != factors[changed] || low[i] != low[changed]))
+      return false;
+    changed = i;
+  }
+  return true;
+}
 
-  for (int i = 0; i < iterations; i++) {
-    result.s = (s_min + s_max) / 2.0f;
-    result.v = (v_min + v_max) / 2.0f;
+// Luminance is monotonic in v for a fixed hue and saturation. Inverting the
+// sRGB curve of the full-value color through the table gives a v within
+// LUMINANCE_BRACKET_LOW..HIGH times the answer; that bracket, or the full
+// range on a side the estimate misses, is bisected until its two colors are
+// neighbors on the curve. The closer of them is the best color there is.
+Color solve_luminance(float luminance_desired, float hue, float saturation) {
+  float factors[3];
+  hsv_value_factors(hue, saturation, factors);
 
-    Color test_color = hsv_to_rgb(result);
-    float current_lum = w3_luminance(test_color);
+  Color lo_color = {0, 0, 0};
+  Color hi_color = scale_value(factors, 1.0f);
+  float lo_lum = 0.0f;
+  float hi_lum = w3_luminance(hi_color);
+  if (luminance_desired <= lo_lum)
+    return lo_color;
+  if (luminance_desired >= hi_lum)
+    return hi_color;
+
+  float fraction = luminance_desired / hi_lum;
+  float guess = linear_to_srgb_lut[(int)(fraction * LINEAR_LUT_SIZE)] / 255.0f;
+  float lo = guess * LUMINANCE_BRACKET_LOW;
+  float hi = fminf(guess * LUMINANCE_BRACKET_HIGH, 1.0f);
+
+  Color color = scale_value(factors, lo);
+  float lum = w3_luminance(color);
+  if (lum < luminance_desired) {
+    lo_color = color;
+    lo_lum = lum;
+  } else {
+    lo = 0.0f;
+  }
+  color = scale_value(factors, hi);
+  lum = w3_luminance(color);
+  if (lum >= luminance_desired) {
+    hi_color = color;
+    hi_lum = lum;
+  } else {
+    hi = 1.0f;
+  }
 
-    if (current_lum >= luminance_desired) {
-      s_min = result.s;
-      v_max = result.v;
+  for (int i = 0; i < LUMINANCE_ITERATIONS; i++) {
+    float mid = (lo + hi) / 2.0f;
+    if (adjacent(lo_color, hi_color, factors) || mid == lo || mid == hi)
+      break;
+    color = scale_value(factors, mid);
+    lum = w3_luminance(color);
+    if (lum >= luminance_desired) {
+      hi = mid;
+      hi_color = color;
+      hi_lum = lum;
     } else {
-      s_max = result.s;
-      v_min = result.v;
+      lo = mid;
+      lo_color = color;
+      lo_lum = lum;
     }
   }
 
-  result.s = (s_min + s_max) / 2.0f;
-  result.v = (v_min + v_max) / 2.0f;
-  return hsv_to_rgb(result);
+  return (luminance_desired - lo_lum <= hi_lum - luminance_desired) ? lo_color
+                                                                    : hi_color;
 }
@@ -12,10 +12,18 @@
 
 #include "core.h"
 
+// solve_luminance bisects between these multiples of its table estimate
+#define LUMINANCE_BRACKET_LOW 0.5f
+#define LUMINANCE_BRACKET_HIGH 1.125f
+#define LUMINANCE_ITERATIONS 24 // Bisection steps at most; a float has 24 bits
+
+// Shade operations in Q16 fixed point. They skip the float HSL round trip
+// and stay within 1 per channel of the float formulas.
 Color darken_color(Color clr, float amount);
 Color lighten_color(Color clr, float amount);
 Color saturate_color(Color clr, float amount);
 float w3_luminance(Color clr);
-Color binary_luminance_adjust(float luminance_desired, float hue, float s_min,
-                              float s_max, float v_min, float v_max,
-                              int iterations);
+float contrast_ratio(Color a, Color b);
+// Color of the given hue and saturation whose luminance is closest to
+// luminance_desired
+Color solve_luminance(float luminance_desired, float hue, float saturation);
@@ -9,10 +9,13 @@
  */
 
 #include "colors.h"
+#include "color_batch.h"
 #include "color_conversion.h"
+#include "color_lanes.h"
 #include "color_operation.h"
 #include "utils/utils.h"
 #include <math.h>
+#include <stdlib.h>
 
 #define MIN_BRIGHTNESS_THRESHOLD 0.88f
 #define TARGET_LIGHTEN_AMOUNT 0.93f
@@ -27,6 +30,10 @@
 #define VALUE_BOOST 0.3f
 #define SATURATION_BOOST 0.4f
 #define MAX_BRIGHTNESS_THRESHOLD 0.97f
+#define MIN_LIGHTNESS 0.45f // OKLCH counterpart of MIN_VALUE
+#define MAX_DARK_BACKGROUND 0.30f
+#define MIN_DARK_BACKGROUND 0.12f
+#define LIGHTNESS_NUDGE 0.002f // OKLCH step when rounding loses contrast
 
 // Pre-processes the palette to boost colors from dark images
 static void boost_dark_colors(Palette *palette) {
@@ -125,8 +132,7 @@ static void ensure_contrast(Palette *palette, float contrast, bool light,
 
     HSV hsv = rgb_to_hsv(current_color);
 
-    palette->colors[i] = binary_luminance_adjust(target_luminance, hsv.h, hsv.s,
-                                                 hsv.s, 0.0f, 1.0f, 10);
+    palette->colors[i] = solve_luminance(target_luminance, hsv.h, hsv.s);
   }
 }
 
@@ -166,7 +172,141 @@ static void generate_16_colors(Palette *palette) {
   }
 }
 
+// OKLCH engine. The palette is converted once, adjusted in floating point and
+// converted back at the end, so steps don't compound 8-bit rounding. Chroma is
+// compared as a fraction of OKLCH_MAX_CHROMA so the HSV thresholds carry over.
+
+static float relative_chroma(OKLCH lch) {
+  return lch.c / OKLCH_MAX_CHROMA;
+}
+
+static OKLCH boost_chroma(OKLCH lch) {
+  float chroma = relative_chroma(lch);
+  if (chroma < MIN_SATURATION)
+    lch.c = (chroma + SATURATION_BOOST * (1.0f - chroma)) * OKLCH_MAX_CHROMA;
+  return lch;
+}
+
+static float oklch_luminance(OKLCH lch) {
+  return oklab_luminance(oklch_to_oklab(oklch_gamut_map(lch)));
+}
+
+static void boost_oklch_colors(OKLCH *lch, bool light) {
+  for (int i = 1; i < 7; i++) {
+    if (light) {
+      if (oklch_luminance(lch[i]) > 0.6f)
+        lch[i] = oklch_darken(lch[i], 0.3f);
+    } else if (lch[i].l < MIN_LIGHTNESS) {
+      lch[i].l += VALUE_BOOST * (1.0f - lch[i].l);
+    }
+    lch[i] = boost_chroma(lch[i]);
+  }
+}
+
+static void adjust_oklch_background(OKLCH *lch, bool light) {
+  if (light) {
+    // Lightness is separable, so the target luminance is set directly.
+    float current_lum = oklch_luminance(lch[0]);
+    if (current_lum < MIN_BRIGHTNESS_THRESHOLD ||
+        current_lum > MAX_BRIGHTNESS_THRESHOLD)
+      lch[0] = oklch_with_luminance(lch[0], TARGET_LIGHTEN_AMOUNT);
+    return;
+  }
+
+  if (lch[0].l > MAX_DARK_BACKGROUND)
+    lch[0] = oklch_darken(lch[0], DARKEN_AMOUNT);
+  if (lch[0].l < MIN_DARK_BACKGROUND) {
+    lch[0] = oklch_lighten(lch[0], LIGHTEN_AMOUNT);
+    lch[0].c *= 1.0f + SATURATE_AMOUNT;
+  }
+}
+
+static void generate_16_oklch(OKLCH *lch, const Palette *palette) {
+  if (palette->mode == LIGHT) {
+    lch[7] = oklch_saturate(oklch_darken(lch[0], 0.60f), 0.05f);
+    lch[8] = oklch_saturate(oklch_darken(lch[0], 0.30f), 0.10f);
+    lch[15] = oklch_darken(lch[0], 0.90f);
+  } else {
+    lch[7] = oklch_saturate(oklch_lighten(lch[0], 0.60f), 0.05f);
+    lch[8] = oklch_saturate(oklch_lighten(lch[0], 0.40f), 0.10f);
+    lch[15] = oklch_lighten(lch[0], 0.80f);
+  }
+
+  for (int i = 1; i < 7; i++) {
+    if (palette->mode == DARK)
+      lch[i + 8] = oklch_lighten(lch[i], 0.25f);
+    else if (palette->cols16_mode == LIGHTEN)
+      lch[i + 8] = oklch_lighten(lch[i], 0.15f);
+    else
+      lch[i + 8] = oklch_darken(lch[i], 0.15f);
+    lch[i + 8] = oklch_saturate(lch[i + 8], 0.30f);
+  }
+}
+
+// The ratios are measured on the colors as they will be written: one met in
+// float can be lost when the channels are rounded to bytes, so the lightness
+// is nudged away from the background until the rounded color passes.
+static void ensure_oklch_contrast(OKLCH *lch, float contrast, bool light) {
+  if (contrast == 1.0f || contrast == 0.0f)
+    return;
+
+  Color background = oklch_to_rgb(lch[0]);
+  float background_luminance = w3_luminance(background);
+  float min_ratio = light ? MIN_CONTRAST_RATIO_LIGHT : MIN_CONTRAST_RATIO_DARK;
+  float target_luminance =
+      background_luminance > 0.5f
+          ? fmaxf(0.0f, (background_luminance + 0.05f) / min_ratio - 0.05f)
+          : fminf(1.0f, (background_luminance + 0.05f) * min_ratio - 0.05f);
+  float nudge =
+      background_luminance > 0.5f ? -LIGHTNESS_NUDGE : LIGHTNESS_NUDGE;
+
+  for (int i = 1; i < 15; i++) {
+    if (contrast_ratio(oklch_to_rgb(lch[i]), background) >=
+        fmaxf(contrast, min_ratio))
+      continue;
+
+    lch[i] = oklch_with_luminance(lch[i], target_luminance);
+    while (contrast_ratio(oklch_to_rgb(lch[i]), background) < min_ratio &&
+           lch[i].l > 0.0f && lch[i].l < 1.0f)
+      lch[i].l = clamp_value(lch[i].l + nudge);
+  }
+}
+
+static void process_colors_oklch(Palette *palette) {
+  bool light = palette->mode == LIGHT;
+  if (light)
+    reverse_colors(palette);
+
+  OKLab lab[PALETTE_MAX_SIZE];
+  OKLCH lch[PALETTE_MAX_SIZE];
+  rgb_to_oklab_batch((const uint8_t *)palette->colors, sizeof(Color), lab,
+                     PALETTE_MAX_SIZE);
+  for (int i = 0; i < PALETTE_MAX_SIZE; i++)
+    lch[i] = oklab_to_oklch(lab[i]);
+
+  boost_oklch_colors(lch, light);
+  adjust_oklch_background(lch, light);
+  generate_16_oklch(lch, palette);
+
+  if (palette->saturation != 0.0f) {
+    for (int i = 0; i < PALETTE_MAX_SIZE; i++) {
+      if (i != 7 && i != 15)
+        lch[i] = oklch_saturate(lch[i], palette->saturation);
+    }
+  }
+  ensure_oklch_contrast(lch, palette->contrast, light);
+
+  for (int i = 0; i < PALETTE_MAX_SIZE; i++)
+    lab[i] = oklch_to_oklab(oklch_gamut_map(lch[i]));
+  oklab_to_rgb_batch(lab, palette->colors, PALETTE_MAX_SIZE);
+}
+
 void process_colors(Palette *palette) {
+  if (palette->engine == ENGINE_OKLCH) {
+    process_colors_oklch(palette);
+    return;
+  }
+
   // First, check if we are in dark mode and boost colors if they are too
   // dark/desaturated
   if (palette->mode == DARK) {
@@ -211,3 +351,375 @@ void process_colors(Palette *palette) {
   ensure_contrast(palette, palette->contrast, palette->mode == LIGHT,
                   palette->colors[0]);
 }
+
+int palette_batch_init(PaletteBatch *batch, size_t capacity) {
+  if (!batch)
+    return -1;
+  *batch = (PaletteBatch){0};
+
+  // Pointers first, then floats, then bytes, so every array stays aligned.
+  size_t pointers = capacity * sizeof(char *);
+  size_t floats = 3 * capacity * sizeof(float);
+  size_t bytes = (3 * PALETTE_MAX_SIZE + 3) * capacity;
+  char *storage = malloc(pointers + floats + bytes);
+  if (!storage) {
+    logging(ERROR, "Failed to allocate palette batch of %zu", capacity);
+    return -1;
+  }
+
+  batch->storage = storage;
+  batch->capacity = capacity;
+  batch->wallpaper = (char **)storage;
+  batch->saturation = (float *)(storage + pointers);
+  batch->contrast = batch->saturation + capacity;
+  batch->alpha = batch->contrast + capacity;
+
+  uint8_t *next = (uint8_t *)(batch->alpha + capacity);
+  for (int k = 0; k < PALETTE_MAX_SIZE; k++) {
+    batch->red[k] = next;
+    batch->green[k] = next + capacity;
+    batch->blue[k] = next + 2 * capacity;
+    next += 3 * capacity;
+  }
+  batch->mode = next;
+  batch->cols16_mode = next + capacity;
+  batch->engine = next + 2 * capacity;
+  return 0;
+}
+
+void palette_batch_free(PaletteBatch *batch) {
+  if (!batch)
+    return;
+  free(batch->storage);
+  *batch = (PaletteBatch){0};
+}
+
+static void palette_batch_set(PaletteBatch *batch, size_t index,
+                              const Palette *palette) {
+  for (int k = 0; k < PALETTE_MAX_SIZE; k++) {
+    batch->red[k][index] = palette->colors[k].red;
+    batch->green[k][index] = palette->colors[k].green;
+    batch->blue[k][index] = palette->colors[k].blue;
+  }
+  batch->saturation[index] = palette->saturation;
+  batch->contrast[index] = palette->contrast;
+  batch->alpha[index] = palette->alpha;
+  batch->mode[index] = (uint8_t)palette->mode;
+  batch->cols16_mode[index] = (uint8_t)palette->cols16_mode;
+  batch->engine[index] = (uint8_t)palette->engine;
+  batch->wallpaper[index] = palette->wallpaper;
+}
+
+int palette_batch_push(PaletteBatch *batch, const Palette *palette) {
+  if (!batch || !palette || batch->count >= batch->capacity)
+    return -1;
+  palette_batch_set(batch, batch->count++, palette);
+  return 0;
+}
+
+void palette_batch_get(const PaletteBatch *batch, size_t index,
+                       Palette *palette) {
+  if (!batch || !palette || index >= batch->count)
+    return;
+  for (int k = 0; k < PALETTE_MAX_SIZE; k++) {
+    palette->colors[k] = (Color){batch->red[k][index], batch->green[k][index],
+                                 batch->blue[k][index]};
+  }
+  palette->saturation = batch->saturation[index];
+  palette->contrast = batch->contrast[index];
+  palette->alpha = batch->alpha[index];
+  palette->mode = (COLOR_MODE)batch->mode[index];
+  palette->cols16_mode = (SHADE_MODE)batch->cols16_mode[index];
+  palette->engine = (COLOR_ENGINE)batch->engine[index];
+  palette->wallpaper = batch->wallpaper[index];
+}
+
+// Batch HSV engine. Each stage mirrors its single-palette counterpart above
+// operation for operation, on VECTOR_WIDTH palettes at a time: branches on
+// per-palette settings become selects, and work is skipped only when no lane
+// would use it.
+
+typedef struct {
+  VColor colors[PALETTE_MAX_SIZE];
+  vfloat saturation;
+  vfloat contrast;
+  vint light;   // mode == LIGHT
+  vint lighten; // cols16_mode == LIGHTEN
+} VPalette;
+
+LANE void vboost_colors(VPalette *p) {
+  bool any_light = vany(p->light);
+  bool any_dark = vany(~p->light);
+
+  // reverse_colors for light palettes
+  if (any_light) {
+    for (int i = 0; i < 4; i++) {
+      VColor low = p->colors[i], high = p->colors[7 - i];
+      p->colors[i] = vselect_color(p->light, high, low);
+      p->colors[7 - i] = vselect_color(p->light, low, high);
+    }
+  }
+
+  for (int i = 1; i < 7; i++) {
+    VColor color = p->colors[i];
+    VColor dark = color, light = color;
+
+    // boost_dark_colors
+    if (any_dark) {
+      VHSV hsv = vrgb_to_hsv(color);
+      vint dim = hsv.v < MIN_VALUE;
+      vint dull = hsv.s < MIN_SATURATION;
+      hsv.v = vselect(dim, hsv.v + VALUE_BOOST * (1.0f - hsv.v), hsv.v);
+      hsv.s = vselect(dull, hsv.s + SATURATION_BOOST * (1.0f - hsv.s), hsv.s);
+      dark = vselect_color(dim | dull, vhsv_to_rgb(hsv), color);
+    }
+
+    // boost_light_colors
+    if (any_light) {
+      light = vselect_color(vluminance(color) > 0.6f,
+                            vdarken(color, vsplat(0.3f)), color);
+      VHSV hsv = vrgb_to_hsv(light);
+      vint dull = hsv.s < MIN_SATURATION;
+      hsv.s += SATURATION_BOOST * (1.0f - hsv.s);
+      light = vselect_color(dull, vhsv_to_rgb(hsv), light);
+    }
+
+    p->colors[i] = vselect_color(p->light, light, dark);
+  }
+}
+
+LANE void vadjust_background(VPalette *p) {
+  VColor background = p->colors[0];
+
+  vfloat lum = vluminance(background);
+  VColor light = vselect_color(
+      lum < MIN_BRIGHTNESS_THRESHOLD,
+      vlighten(background, TARGET_LIGHTEN_AMOUNT - lum),
+      vselect_color(lum > MAX_BRIGHTNESS_THRESHOLD,
+                    vdarken(background, lum - TARGET_LIGHTEN_AMOUNT),
+                    background));
+
+  vint saturate_more = (background.red < COLOR_THRESHOLD) |
+                       (background.green < COLOR_THRESHOLD) |
+                       (background.blue < COLOR_THRESHOLD);
+  VColor dark = vselect_color(background.red >= COLOR_THRESHOLD,
+                              vdarken(background, vsplat(DARKEN_AMOUNT)),
+                              background);
+  if (vany(saturate_more)) {
+    VColor lifted = vlighten(dark, vsplat(LIGHTEN_AMOUNT));
+    dark = vselect_color(saturate_more,
+                         vsaturate(lifted, vsplat(SATURATE_AMOUNT)), dark);
+  }
+
+  p->colors[0] = vselect_color(p->light, light, dark);
+}
+
+LANE void vgenerate_16_colors(VPalette *p) {
+  VColor background = p->colors[0];
+  vint light = p->light;
+
+  VColor c7 = vselect_color(light, vdarken(background, vsplat(0.60f)),
+                            vlighten(background, vsplat(0.60f)));
+  VColor c8 = vselect_color(light, vdarken(background, vsplat(0.30f)),
+                            vlighten(background, vsplat(0.40f)));
+  p->colors[7] = vsaturate(c7, vsplat(0.05f));
+  p->colors[8] = vsaturate(c8, vsplat(0.10f));
+  p->colors[15] = vselect_color(light, vdarken(background, vsplat(0.90f)),
+                                vlighten(background, vsplat(0.80f)));
+
+  // Dark palettes and LIGHTEN light palettes lighten, the rest darken
+  vint lighten = ~light | p->lighten;
+  vfloat amount = vselect(light, vsplat(0.15f), vsplat(0.25f));
+  for (int i = 1; i < 7; i++) {
+    VColor shade = vselect_color(lighten, vlighten(p->colors[i], amount),
+                                 vdarken(p->colors[i], vsplat(0.15f)));
+    p->colors[i + 8] = vsaturate(shade, vsplat(0.30f));
+  }
+}
+
+LANE void vsaturate_all_colors(VPalette *p) {
+  vint active = p->saturation != 0.0f;
+  if (!vany(active))
+    return;
+  for (int i = 0; i < PALETTE_MAX_SIZE; i++) {
+    if (i != 7 && i != 15) {
+      p->colors[i] = vselect_color(
+          active, vsaturate(p->colors[i], p->saturation), p->colors[i]);
+    }
+  }
+}
+
+LANE void vensure_contrast(VPalette *p) {
+  vint active = (p->contrast != 1.0f) & (p->contrast != 0.0f);
+  if (!vany(active))
+    return;
+
+  vfloat background_luminance = vluminance(p->colors[0]);
+  vfloat min_ratio = vselect(p->light, vsplat(MIN_CONTRAST_RATIO_LIGHT),
+                             vsplat(MIN_CONTRAST_RATIO_DARK));
+  vfloat threshold = vmax(p->contrast, min_ratio);
+  vfloat target = vselect(
+      background_luminance > 0.5f,
+      vmax(vsplat(0.0f), (background_luminance + 0.05f) / min_ratio - 0.05f),
+      vmin(vsplat(1.0f), (background_luminance + 0.05f) * min_ratio - 0.05f));
+
+  for (int i = 1; i < 15; i++) {
+    VColor color = p->colors[i];
+    vfloat current_lum = vluminance(color);
+    vfloat actual_contrast =
+        (vmax(current_lum, background_luminance) + 0.05f) /
+        (vmin(current_lum, background_luminance) + 0.05f);
+    vint needed = active & ~(actual_contrast >= threshold);
+    if (!vany(needed))
+      continue;
+    // solve_luminance stops as soon as its answer is exact, so lanes run it
+    // one by one instead of all waiting on the slowest
+    VHSV hsv = vrgb_to_hsv(color);
+    for (int lane = 0; lane < VECTOR_WIDTH; lane++) {
+      if (!needed[lane])
+        continue;
+      Color solved = solve_luminance(target[lane], hsv.h[lane], hsv.s[lane]);
+      p->colors[i].red[lane] = solved.red;
+      p->colors[i].green[lane] = solved.green;
+      p->colors[i].blue[lane] = solved.blue;
+    }
+  }
+}
+
+LANE void vprocess_colors(VPalette *p) {
+  vboost_colors(p);
+  vadjust_background(p);
+  vgenerate_16_colors(p);
+  vsaturate_all_colors(p);
+  vensure_contrast(p);
+}
+
+// Processes palettes [start, start + count) of the batch, count at most
+// VECTOR_WIDTH; unused lanes are zero and their results dropped.
+LANE void process_group(PaletteBatch *batch, size_t start, size_t count) {
+  VPalette p = {0};
+  for (size_t j = 0; j < count; j++) {
+    size_t index = start + j;
+    for (int i = 0; i < PALETTE_MAX_SIZE; i++) {
+      p.colors[i].red[j] = batch->red[i][index];
+      p.colors[i].green[j] = batch->green[i][index];
+      p.colors[i].blue[j] = batch->blue[i][index];
+    }
+    p.saturation[j] = batch->saturation[index];
+    p.contrast[j] = batch->contrast[index];
+    p.light[j] = (batch->mode[index] == LIGHT) ? -1 : 0;
+    p.lighten[j] = (batch->cols16_mode[index] == LIGHTEN) ? -1 : 0;
+  }
+
+  vprocess_colors(&p);
+
+  for (size_t j = 0; j < count; j++) {
+    size_t index = start + j;
+    for (int i = 0; i < PALETTE_MAX_SIZE; i++) {
+      batch->red[i][index] = (uint8_t)p.colors[i].red[j];
+      batch->green[i][index] = (uint8_t)p.colors[i].green[j];
+      batch->blue[i][index] = (uint8_t)p.colors[i].blue[j];
+    }
+  }
+}
+
+TARGET_SSE2 static void process_group_baseline(PaletteBatch *batch,
+                                               size_t start, size_t count) {
+  process_group(batch, start, count);
+}
+
+#if CWAL_X86
+TARGET_AVX2 static void process_group_avx2(PaletteBatch *batch, size_t start,
+                                           size_t count) {
+  process_group(batch, start, count);
+}
+
+TARGET_AVX512 static void process_group_avx512(PaletteBatch *batch,
+                                               size_t start, size_t count) {
+  process_group(batch, start, count);
+}
+#endif
+
+void process_colors_batch(PaletteBatch *batch) {
+  if (!batch)
+    return;
+
+  void (*kernel)(PaletteBatch *, size_t, size_t) = NULL;
+  switch (color_batch_level()) {
+#if CWAL_X86
+  case SIMD_AVX512:
+    kernel = process_group_avx512;
+    break;
+  case SIMD_AVX2:
+    kernel = process_group_avx2;
+    break;
+#endif
+  case SIMD_SCALAR:
+    break;
+  default:
+    kernel = process_group_baseline;
+    break;
+  }
+
+  for (size_t start = 0; start < batch->count; start += VECTOR_WIDTH) {
+    size_t count = batch->count - start;
+    if (count > VECTOR_WIDTH)
+      count = VECTOR_WIDTH;
+
+    // The scalar level and OKLCH palettes take the single-palette path. They
+    // run first since the kernel rewrites every lane of the group.
+    Palette reference[VECTOR_WIDTH];
+    bool use_reference[VECTOR_WIDTH];
+    for (size_t j = 0; j < count; j++) {
+      use_reference[j] = !kernel || batch->engine[start + j] != ENGINE_HSV;
+      if (use_reference[j]) {
+        palette_batch_get(batch, start + j, &reference[j]);
+        process_colors(&reference[j]);
+      }
+    }
+
+    if (kernel)
+      kernel(batch, start, count);
+
+    for (size_t j = 0; j < count; j++) {
+      if (use_reference[j])
+        palette_batch_set(batch, start + j, &reference[j]);
+    }
+  }
+}
+
+int process_color_variants(const Palette *raw,
+                           Palette variants[PALETTE_VARIANTS]) {
+  static const COLOR_MODE modes[] = {DARK, LIGHT};
+  static const SHADE_MODE shades[] = {DARKEN, LIGHTEN};
+  SHADE_MODE requested_shade = (raw->cols16_mode == LIGHTEN) ? LIGHTEN : DARKEN;
+
+  int requested = 0;
+  for (int m = 0; m < 2; m++) {
+    for (int c = 0; c < 2; c++) {
+      Palette *variant = &variants[m * 2 + c];
+      *variant = *raw;
+      variant->mode = modes[m];
+      variant->cols16_mode = shades[c];
+      if (variant->mode == raw->mode && variant->cols16_mode == requested_shade)
+        requested = m * 2 + c;
+    }
+  }
+
+  // The batch only pays off with a vector kernel; tests/test_colors_batch
+  // checks it does at every level
+  PaletteBatch batch;
+  if (color_batch_level() == SIMD_SCALAR ||
+      palette_batch_init(&batch, PALETTE_VARIANTS) != 0) {
+    for (int i = 0; i < PALETTE_VARIANTS; i++)
+      process_colors(&variants[i]);
+    return requested;
+  }
+  for (int i = 0; i < PALETTE_VARIANTS; i++)
+    palette_batch_push(&batch, &variants[i]);
+  process_colors_batch(&batch);
+  for (int i = 0; i < PALETTE_VARIANTS; i++)
+    palette_batch_get(&batch, i, &variants[i]);
+  palette_batch_free(&batch);
+  return requested;
+}
@@ -11,5 +11,42 @@
 #pragma once
 
 #include "core.h"
+#include <stddef.h>
+
+// Structure-of-arrays palettes for bulk processing: red[slot][i] is the red
+// channel of color `slot` in palette `i`. Wallpaper pointers are borrowed.
+typedef struct {
+  size_t count;
+  size_t capacity;
+  uint8_t *red[PALETTE_MAX_SIZE];
+  uint8_t *green[PALETTE_MAX_SIZE];
+  uint8_t *blue[PALETTE_MAX_SIZE];
+  float *saturation;
+  float *contrast;
+  float *alpha;
+  uint8_t *mode;        // COLOR_MODE
+  uint8_t *cols16_mode; // SHADE_MODE
+  uint8_t *engine;      // COLOR_ENGINE
+  char **wallpaper;
+  void *storage; // Single allocation backing the arrays above
+} PaletteBatch;
 
 void process_colors(Palette *palette);
+
+int palette_batch_init(PaletteBatch *batch, size_t capacity);
+void palette_batch_free(PaletteBatch *batch);
+int palette_batch_push(PaletteBatch *batch, const Palette *palette);
+void palette_batch_get(const PaletteBatch *batch, size_t index,
+                       Palette *palette);
+// Same result as process_colors on each palette, bit for bit, with the HSV
+// engine vectorized across palettes.
+void process_colors_batch(PaletteBatch *batch);
+
+// Every mode and cols16 combination: DARK/LIGHT x DARKEN/LIGHTEN
+#define PALETTE_VARIANTS 4
+
+// Post-processes the raw backend colors once per variant, keeping the other
+// settings of `raw`. Returns the index of the variant matching raw's own
+// mode and cols16_mode.
+int process_color_variants(const Palette *raw,
+                           Palette variants[PALETTE_VARIANTS]);
@@ -0,0 +1,83 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Build-time generator for color_lut.h. Runs on the build host and writes the
+// sRGB transfer tables so the binary never calls powf for them.
+//   usage: gen_lut <output header>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define LINEAR_LUT_BITS 12
+#define LINEAR_LUT_SIZE (1 << LINEAR_LUT_BITS)
+
+// Same expressions as the float code the tables replace, so lookups are
+// bit-identical to it (tests/test_color_operation.c checks w3_luminance).
+static float srgb_to_linear(float c) {
+  return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float c) {
+  return (c <= 0.0031308f) ? c * 12.92f
+                           : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t to_byte(float value) {
+  if (value < 0.0f)
+    return 0;
+  if (value > 255.0f)
+    return 255;
+  return (uint8_t)(value + 0.5f);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <output header>\n", argv[0]);
+    return 1;
+  }
+  FILE *out = fopen(argv[1], "w");
+  if (!out) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  fprintf(out, "// Generated by src/color/gen_lut.c. Do not edit.\n\n");
+  fprintf(out, "#pragma once\n\n#include <stdint.h>\n\n");
+  fprintf(out, "#define LINEAR_LUT_BITS %d\n", LINEAR_LUT_BITS);
+  fprintf(out, "#define LINEAR_LUT_SIZE %d\n\n", LINEAR_LUT_SIZE);
+
+  fprintf(out, "// sRGB byte -> linear light\n");
+  fprintf(out, "static const float srgb_to_linear_lut[256] = {\n");
+  for (int i = 0; i < 256; i++)
+    fprintf(out, "    %.8ef,\n", srgb_to_linear(i / 255.0f));
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "// Linear light halfway between adjacent sRGB bytes; the last\n"
+               "// entry is FLT_MAX so searches never step past 255\n");
+  fprintf(out, "static const float srgb_midpoints_lut[256] = {\n");
+  for (int i = 0; i < 255; i++)
+    fprintf(out, "    %.8ef,\n", srgb_to_linear((i + 0.5f) / 255.0f));
+  fprintf(out, "    3.40282347e+38f,\n};\n\n");
+
+  fprintf(out, "// Linear light sampled at i / LINEAR_LUT_SIZE -> sRGB byte\n");
+  fprintf(out, "static const uint8_t linear_to_srgb_lut[%d] = {\n",
+          LINEAR_LUT_SIZE + 1);
+  for (int i = 0; i <= LINEAR_LUT_SIZE; i++)
+    fprintf(out, "    %u,\n",
+            to_byte(linear_to_srgb((float)i / LINEAR_LUT_SIZE) * 255.0f));
+  fprintf(out, "};\n");
+
+  if (fclose(out) != 0) {
+    perror(argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -16,6 +16,10 @@
 #include <string.h>
 #include <strings.h>
 
+#define FINGERPRINT_WIDTH 9 // Each row gives 8 neighbour comparisons
+#define FINGERPRINT_HEIGHT 8
+#define FINGERPRINT_PIXELS (FINGERPRINT_WIDTH * FINGERPRINT_HEIGHT)
+
 // Initialize MagickWand on first use.
 static void init_magickwand_once() {
   static int is_initialized = 0;
@@ -98,3 +102,57 @@ void image_free(RawImage *img) {
     free(img);
   }
 }
+
+int image_fingerprint(const RawImage *image, uint64_t *dhash,
+                      Color *average) {
+  if (!image || image->width <= 0 || image->height <= 0)
+    return -1;
+
+  // Box-averages the image into 9x8 cells; cells of an image smaller than
+  // that repeat its pixels.
+  int gray[FINGERPRINT_PIXELS];
+  uint64_t total[3] = {0, 0, 0};
+  for (int cy = 0; cy < FINGERPRINT_HEIGHT; cy++) {
+    int y0 = cy * image->height / FINGERPRINT_HEIGHT;
+    int y1 = (cy + 1) * image->height / FINGERPRINT_HEIGHT;
+    if (y1 <= y0)
+      y1 = y0 + 1;
+    for (int cx = 0; cx < FINGERPRINT_WIDTH; cx++) {
+      int x0 = cx * image->width / FINGERPRINT_WIDTH;
+      int x1 = (cx + 1) * image->width / FINGERPRINT_WIDTH;
+      if (x1 <= x0)
+        x1 = x0 + 1;
+
+      uint64_t sum[3] = {0, 0, 0};
+      for (int y = y0; y < y1; y++) {
+        const unsigned char *p =
+            image->pixels +
+            ((size_t)y * image->width + x0) * image->channels;
+        for (int x = x0; x < x1; x++, p += image->channels) {
+          for (int c = 0; c < 3; c++)
+            sum[c] += p[c];
+        }
+      }
+      uint64_t count = (uint64_t)(y1 - y0) * (uint64_t)(x1 - x0);
+      gray[cy * FINGERPRINT_WIDTH + cx] =
+          (int)((299 * sum[0] + 587 * sum[1] + 114 * sum[2]) / count);
+      for (int c = 0; c < 3; c++)
+        total[c] += sum[c] * FINGERPRINT_PIXELS / count;
+    }
+  }
+
+  uint64_t hash = 0;
+  for (int y = 0; y < FINGERPRINT_HEIGHT; y++) {
+    for (int x = 0; x < FINGERPRINT_WIDTH - 1; x++) {
+      const int *row = &gray[y * FINGERPRINT_WIDTH];
+      hash = (hash << 1) | (uint64_t)(row[x] > row[x + 1]);
+    }
+  }
+  *dhash = hash;
+  // Cells weigh the same, like the pixels of the 9x8 image
+  uint64_t weight = (uint64_t)FINGERPRINT_PIXELS * FINGERPRINT_PIXELS;
+  average->red = (unsigned char)(total[0] / weight);
+  average->green = (unsigned char)(total[1] / weight);
+  average->blue = (unsigned char)(total[2] / weight);
+  return 0;
+}
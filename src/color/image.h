@@ -10,6 +10,9 @@
 
 #pragma once
 
+#include "core.h"
+#include <stdint.h>
+
 // This struct will hold the raw image data.
 typedef struct {
   unsigned char *pixels; // Raw pixel data
@@ -20,3 +23,10 @@ typedef struct {
 
 RawImage *image_load_from_file(const char *path);
 void image_free(RawImage *img);
+
+// Cheap perceptual fingerprint of a decoded image: a 64-bit difference hash
+// of it box-averaged to 9x8 grayscale, which survives resizing and
+// re-encoding, and its average color, which tells apart recolored copies the
+// hash cannot.
+int image_fingerprint(const RawImage *image, uint64_t *dhash,
+                      Color *average);
@@ -0,0 +1,180 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "oklab.h"
+#include "color_lut.h"
+#include "utils/utils.h"
+#include <math.h>
+
+#define GAMUT_EPSILON 0.0001f
+#define GAMUT_ITERATIONS 16
+#define LUMINANCE_STEPS 2 // Correction steps in oklch_with_luminance
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+  float r, g, b;
+} LinearRGB;
+
+static float linear_to_srgb(float c) {
+  return (c <= 0.0031308f) ? c * 12.92f
+                           : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static OKLab linear_to_oklab(LinearRGB rgb) {
+  float l = 0.4122214708f * rgb.r + 0.5363325363f * rgb.g +
+            0.0514459929f * rgb.b;
+  float m = 0.2119034982f * rgb.r + 0.6806995451f * rgb.g +
+            0.1073969566f * rgb.b;
+  float s = 0.0883024619f * rgb.r + 0.2817188376f * rgb.g +
+            0.6299787005f * rgb.b;
+
+  l = cbrtf(l);
+  m = cbrtf(m);
+  s = cbrtf(s);
+
+  OKLab lab = {
+      0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+      1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+      0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s,
+  };
+  return lab;
+}
+
+static LinearRGB oklab_to_linear(OKLab lab) {
+  float l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+  float m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+  float s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+
+  l = l * l * l;
+  m = m * m * m;
+  s = s * s * s;
+
+  LinearRGB rgb = {
+      4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
+      -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
+      -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s,
+  };
+  return rgb;
+}
+
+OKLab rgb_to_oklab(Color clr) {
+  LinearRGB rgb = {srgb_to_linear_lut[clr.red], srgb_to_linear_lut[clr.green],
+                   srgb_to_linear_lut[clr.blue]};
+  return linear_to_oklab(rgb);
+}
+
+Color oklab_to_rgb(OKLab lab) {
+  LinearRGB rgb = oklab_to_linear(lab);
+  Color color = {
+      .red = clamp_byte(linear_to_srgb(clamp_value(rgb.r)) * 255.0f),
+      .green = clamp_byte(linear_to_srgb(clamp_value(rgb.g)) * 255.0f),
+      .blue = clamp_byte(linear_to_srgb(clamp_value(rgb.b)) * 255.0f),
+  };
+  return color;
+}
+
+OKLCH oklab_to_oklch(OKLab lab) {
+  float h = atan2f(lab.b, lab.a) * (180.0f / (float)M_PI);
+  if (h < 0.0f)
+    h += 360.0f;
+  OKLCH lch = {lab.l, sqrtf(lab.a * lab.a + lab.b * lab.b), h};
+  return lch;
+}
+
+OKLab oklch_to_oklab(OKLCH lch) {
+  float h = lch.h * ((float)M_PI / 180.0f);
+  OKLab lab = {lch.l, lch.c * cosf(h), lch.c * sinf(h)};
+  return lab;
+}
+
+OKLCH rgb_to_oklch(Color clr) { return oklab_to_oklch(rgb_to_oklab(clr)); }
+
+Color oklch_to_rgb(OKLCH lch) {
+  return oklab_to_rgb(oklch_to_oklab(oklch_gamut_map(lch)));
+}
+
+bool oklab_in_gamut(OKLab lab) {
+  LinearRGB rgb = oklab_to_linear(lab);
+  return rgb.r >= -GAMUT_EPSILON && rgb.r <= 1.0f + GAMUT_EPSILON &&
+         rgb.g >= -GAMUT_EPSILON && rgb.g <= 1.0f + GAMUT_EPSILON &&
+         rgb.b >= -GAMUT_EPSILON && rgb.b <= 1.0f + GAMUT_EPSILON;
+}
+
+OKLCH oklch_gamut_map(OKLCH lch) {
+  lch.l = clamp_value(lch.l);
+  if (lch.c < 0.0f)
+    lch.c = 0.0f;
+  if (oklab_in_gamut(oklch_to_oklab(lch)))
+    return lch;
+
+  // The achromatic axis is always in gamut, so bisect chroma toward it.
+  float lo = 0.0f, hi = lch.c;
+  for (int i = 0; i < GAMUT_ITERATIONS; i++) {
+    float mid = (lo + hi) / 2.0f;
+    OKLCH test = {lch.l, mid, lch.h};
+    if (oklab_in_gamut(oklch_to_oklab(test)))
+      lo = mid;
+    else
+      hi = mid;
+  }
+  lch.c = lo;
+  return lch;
+}
+
+float oklab_luminance(OKLab lab) {
+  LinearRGB rgb = oklab_to_linear(lab);
+  return 0.2126f * clamp_value(rgb.r) + 0.7152f * clamp_value(rgb.g) +
+         0.0722f * clamp_value(rgb.b);
+}
+
+OKLCH oklch_lighten(OKLCH lch, float amount) {
+  amount = clamp_value(amount);
+  lch.l += (1.0f - lch.l) * amount;
+  lch.c *= 1.0f - amount; // Moving toward white also moves toward gray
+  return lch;
+}
+
+OKLCH oklch_darken(OKLCH lch, float amount) {
+  lch.l *= 1.0f - clamp_value(amount);
+  return lch;
+}
+
+OKLCH oklch_saturate(OKLCH lch, float amount) {
+  lch.c += amount * OKLCH_MAX_CHROMA;
+  if (lch.c < 0.0f)
+    lch.c = 0.0f;
+  return lch;
+}
+
+// On the achromatic axis luminance is exactly L^3, and chroma only perturbs
+// that slightly, so L = cbrt(Y) plus a couple of multiplicative corrections
+// lands on the target without a search.
+OKLCH oklch_with_luminance(OKLCH lch, float luminance) {
+  luminance = clamp_value(luminance);
+  if (luminance <= 0.0f) {
+    lch.l = 0.0f;
+    lch.c = 0.0f;
+    return lch;
+  }
+
+  lch.l = cbrtf(luminance);
+  lch = oklch_gamut_map(lch);
+  for (int i = 0; i < LUMINANCE_STEPS; i++) {
+    float actual = oklab_luminance(oklch_to_oklab(lch));
+    if (actual <= 0.0f)
+      break;
+    lch.l = clamp_value(lch.l * cbrtf(luminance / actual));
+    lch = oklch_gamut_map(lch);
+  }
+  return lch;
+}
@@ -0,0 +1,50 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "core.h"
+
+// Perceptual OKLab (L in 0..1) and its polar form OKLCH (h in degrees).
+typedef struct {
+  float l, a, b;
+} OKLab;
+
+typedef struct {
+  float l, c, h;
+} OKLCH;
+
+// Largest chroma any sRGB color reaches in OKLCH
+#define OKLCH_MAX_CHROMA 0.33f
+
+OKLab rgb_to_oklab(Color clr);
+Color oklab_to_rgb(OKLab lab); // Clips out-of-gamut channels
+OKLCH oklab_to_oklch(OKLab lab);
+OKLab oklch_to_oklab(OKLCH lch);
+OKLCH rgb_to_oklch(Color clr);
+Color oklch_to_rgb(OKLCH lch); // Gamut-maps before converting
+
+bool oklab_in_gamut(OKLab lab);
+// Reduces chroma, keeping lightness and hue, until the color fits in sRGB.
+OKLCH oklch_gamut_map(OKLCH lch);
+
+// WCAG relative luminance of an OKLab color, without rounding to bytes
+float oklab_luminance(OKLab lab);
+
+// Lightness and chroma adjustments; amounts follow lighten_color and
+// saturate_color (0..1 for lightness, chroma offset as a fraction of
+// OKLCH_MAX_CHROMA). Lightening mixes toward white, so it also scales chroma.
+OKLCH oklch_lighten(OKLCH lch, float amount);
+OKLCH oklch_darken(OKLCH lch, float amount);
+OKLCH oklch_saturate(OKLCH lch, float amount);
+
+// Sets the lightness so the color's luminance is `luminance`, keeping chroma
+// and hue (chroma is reduced if the result leaves the gamut).
+OKLCH oklch_with_luminance(OKLCH lch, float luminance);
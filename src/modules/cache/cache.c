@@ -9,86 +9,212 @@
  */
 
 #include "cache.h"
+#include "color/colors.h"
+#include "color/image.h"
+#include "store.h"
+#include "utils/hash.h"
 #include "utils/path.h"
 #include "utils/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #define MAX_LINE_LENGTH 256
+#define IMAGE_KEY_SIZE 17 // 16 hex digits and the terminator
 
-static void generate_cache_filename(char *buffer, size_t buffer_size,
-                                    const Palette *palette,
-                                    const char *cache_dir,
-                                    const char *backend_name) {
-  char *expanded_cache_dir = expand_home(cache_dir);
-  char *filename = strrchr(palette->wallpaper, '/');
-  if (filename) {
-    filename++;
-  } else {
-    filename = palette->wallpaper;
-  }
+#define SAMPLE_FULL_LIMIT (256 * 1024) // Smaller files are hashed whole
+#define SAMPLE_EDGE_SIZE (64 * 1024)   // Bytes hashed at each end
+#define SAMPLE_CHUNK_SIZE 4096
+#define SAMPLE_CHUNKS 32 // Evenly spaced chunks between the edges
 
-  const char *mode_str = (palette->mode == DARK) ? "dark" : "light";
-  const char *cols16_mode_str =
-      (palette->cols16_mode == DARKEN) ? "darken" : "lighten";
+#define SIMILAR_MAX_DISTANCE 3   // dHash bits copies of one image may differ by
+#define SIMILAR_MAX_COLOR_DIFF 8 // Per channel of their average colors
+#define SIMILAR_RECORD "cwal/similar"   // A backend name no script can have
+#define IDENTITY_RECORD "cwal/identity" // Nor this one
+
+#define COMPUTE_LOCK_RANGE (1 << 30) // Lock bytes images are spread over
+#define COMPUTE_WAIT_MS 30000        // Longest wait for another process
+#define COMPUTE_POLL_MS 20
+
+// Raised when process_colors changes its output, so palettes cached by an
+// older cwal are processed again. 2: the fixed-point shades.
+#define PROCESS_REVISION 2
+
+// Fingerprint of an image whose raw palette is cached. It is stored next to
+// the raw palette, under the same key, so it is evicted along with it.
+typedef struct {
+  uint64_t dhash;
+  uint64_t raw_key;
+  Color average;
+} SimilarImage;
+
+// A file's device, inode, mtime and size, and the hash of its content. It is
+// stored in the color bytes of a record in the palette store.
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t mtime_sec;
+  uint64_t mtime_nsec;
+  uint64_t size;
+  uint64_t hash;
+} FileIdentity;
+
+_Static_assert(sizeof(FileIdentity) <= sizeof(((StoredPalette *)0)->colors),
+               "FileIdentity must fit in a store record");
+
+static PaletteStore *open_palette_store(const char *cache_dir);
 
-  snprintf(buffer, buffer_size, "%s/schemes/%s_%s_%s_s%.2f_c%.2f_a%.2f_%s.cwal",
-           expanded_cache_dir, filename, mode_str, cols16_mode_str,
-           palette->saturation, palette->contrast, palette->alpha,
-           backend_name);
-  free(expanded_cache_dir);
+static uint32_t backend_id(const char *backend_name) {
+  return (uint32_t)hash_string(backend_name, 0);
 }
 
-int save_palette_to_cache(const Palette *palette, const char *cache_dir,
-                          const char *backend_name) {
-  char cache_filepath[PATH_MAX];
-  generate_cache_filename(cache_filepath, sizeof(cache_filepath), palette,
-                          cache_dir, backend_name);
+static bool same_identity(const FileIdentity *a, const FileIdentity *b) {
+  return memcmp(a, b, offsetof(FileIdentity, hash)) == 0;
+}
 
-  char *home_cache = expand_home(cache_dir);
-  char *cache_dir_path = build_path(home_cache, "schemes");
-  free(home_cache);
+static uint64_t identity_key(const FileIdentity *id) {
+  return hash_bytes(id, offsetof(FileIdentity, hash), 0);
+}
 
-  if (validate_or_create_dir(cache_dir_path) != 0) {
-    logging(ERROR, "Failed to create cache directory: %s", cache_dir_path);
-    free(cache_dir_path);
-    return -1;
+static int hash_range(int fd, off_t offset, size_t len, uint8_t *buffer,
+                      uint64_t *hash) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, buffer + done, len - done, offset + (off_t)done);
+    if (n <= 0)
+      return -1;
+    done += (size_t)n;
   }
+  *hash = hash_bytes(buffer, len, *hash);
+  return 0;
+}
 
-  FILE *file = fopen(cache_filepath, "w");
-  if (!file) {
-    logging(ERROR, "Failed to open cache file for writing: %s", cache_filepath);
-    free(cache_dir_path);
+// Small files are hashed whole; larger ones by their head, tail and evenly
+// spaced chunks in between. Encoded images change throughout on any edit, and
+// the size is part of the seed.
+static int hash_image_content(const char *path, off_t size, uint64_t *hash) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
     return -1;
-  }
-  free(cache_dir_path);
 
-  fprintf(file, "wallpaper=%s\n", palette->wallpaper);
-  fprintf(file, "alpha=%.2f\n", palette->alpha);
+  size_t buffer_size = size <= SAMPLE_FULL_LIMIT ? (size_t)size
+                                                 : SAMPLE_EDGE_SIZE;
+  uint8_t *buffer = malloc(buffer_size ? buffer_size : 1);
+  if (!buffer) {
+    close(fd);
+    return -1;
+  }
 
-  for (int i = 0; i < PALETTE_MAX_SIZE; i++) {
-    fprintf(file, "color%d=%d,%d,%d\n", i, palette->colors[i].red,
-            palette->colors[i].green, palette->colors[i].blue);
+  *hash = (uint64_t)size;
+  int status;
+  if (size <= SAMPLE_FULL_LIMIT) {
+    status = hash_range(fd, 0, (size_t)size, buffer, hash);
+  } else {
+    status = hash_range(fd, 0, SAMPLE_EDGE_SIZE, buffer, hash);
+    off_t middle = size - 2 * SAMPLE_EDGE_SIZE - SAMPLE_CHUNK_SIZE;
+    for (int i = 0; status == 0 && i < SAMPLE_CHUNKS; i++) {
+      off_t offset = SAMPLE_EDGE_SIZE + middle * i / (SAMPLE_CHUNKS - 1);
+      status = hash_range(fd, offset, SAMPLE_CHUNK_SIZE, buffer, hash);
+    }
+    if (status == 0)
+      status = hash_range(fd, size - SAMPLE_EDGE_SIZE, SAMPLE_EDGE_SIZE,
+                          buffer, hash);
   }
 
-  fclose(file);
-  logging(INFO, "Palette saved to cache: %s", cache_filepath);
+  free(buffer);
+  close(fd);
+  return status;
+}
+
+// Finds the content hash recorded for this device, inode, mtime and size.
+// The lookup stamps the entry's access time like a palette's, so it ages
+// along with the palettes of its image and is evicted in the same pass.
+static int lookup_identity(PaletteStore *store, FileIdentity *id) {
+  uint32_t backend = backend_id(IDENTITY_RECORD);
+  StoredPalette stored;
+  FileIdentity found;
+  if (store_get(store, identity_key(id), &backend, 1, &stored) != 0)
+    return -1;
+  memcpy(&found, stored.colors, sizeof(found));
+  if (!same_identity(&found, id))
+    return -1;
+  id->hash = found.hash;
   return 0;
 }
 
-int load_palette_from_cache(Palette *palette, const char *cache_dir,
-                            const char *backend_name) {
-  char cache_filepath[PATH_MAX];
-  generate_cache_filename(cache_filepath, sizeof(cache_filepath), palette,
-                          cache_dir, backend_name);
+static void record_identity(PaletteStore *store, const FileIdentity *id) {
+  StoredPalette stored = {0};
+  memcpy(stored.colors, id, sizeof(*id));
+  if (store && store_put(store, identity_key(id), backend_id(IDENTITY_RECORD),
+                         &stored) != 0)
+    logging(WARN, "Failed to record the image's identity.");
+}
 
-  FILE *file = fopen(cache_filepath, "r");
-  if (!file) {
+// Cache key of an image's content. A stat() that matches an identity in the
+// palette store (or the previous call) skips reading the file, so renamed and
+// moved images keep their key; copies and unknown files are hashed from a
+// sparse sample.
+static int image_key(const char *wallpaper, const char *cache_dir,
+                     char key[IMAGE_KEY_SIZE]) {
+  static FileIdentity last_id;
+  static bool have_last = false;
+
+  struct stat st;
+  if (!wallpaper || stat(wallpaper, &st) != 0)
     return -1;
+  FileIdentity id = {.dev = st.st_dev,
+                     .ino = st.st_ino,
+                     .mtime_sec = (uint64_t)st.st_mtim.tv_sec,
+                     .mtime_nsec = (uint64_t)st.st_mtim.tv_nsec,
+                     .size = (uint64_t)st.st_size};
+
+  if (have_last && same_identity(&id, &last_id)) {
+    id.hash = last_id.hash;
+  } else {
+    PaletteStore *store = open_palette_store(cache_dir);
+    if (lookup_identity(store, &id) != 0) {
+      if (hash_image_content(wallpaper, st.st_size, &id.hash) != 0)
+        return -1;
+      record_identity(store, &id);
+    }
+    last_id = id;
+    have_last = true;
   }
 
+  snprintf(key, IMAGE_KEY_SIZE, "%016" PRIx64, id.hash);
+  return 0;
+}
+
+static PaletteStore *palette_store = NULL;
+static PaletteStore *shared_store = NULL;
+static const char *shared_dir = NULL;
+static bool shared_opened = false;
+static bool shared_writable = false;
+static CacheLimits cache_limits = {0, 0};
+static int compute_lock_fd = -1;
+// Fingerprint of the last image looked up by similarity, recorded once its
+// raw palette is saved.
+static SimilarImage pending_similar;
+static bool has_pending_similar = false;
+
+static int parse_cache_file(const char *path, char *wallpaper,
+                            size_t wallpaper_size, StoredPalette *palette) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+
+  int found = 0;
+  wallpaper[0] = '\0';
+  palette->alpha = 1.0f;
   char line[MAX_LINE_LENGTH];
   char *saveptr;
   while (fgets(line, sizeof(line), file)) {
@@ -99,28 +225,527 @@ int load_palette_from_cache(Palette *palette, const char *cache_dir,
       continue;
 
     if (strncmp(key, "wallpaper", 10) == 0) {
-      if (strncmp(value, palette->wallpaper, strlen(palette->wallpaper) + 1) !=
-          0) {
-        fclose(file);
-        return -1;
-      }
+      snprintf(wallpaper, wallpaper_size, "%s", value);
     } else if (strncmp(key, "alpha", 6) == 0) {
       palette->alpha = atof(value);
     } else if (strncmp(key, "color", 5) == 0) {
       int index = atoi(key + 5);
-      if (index >= 0 && index < PALETTE_MAX_SIZE) {
-        int r, g, b;
-        if (sscanf(value, "%d,%d,%d", &r, &g, &b) == 3) {
-          palette->colors[index] = (Color){(uint8_t)r, (uint8_t)g, (uint8_t)b};
-        } else {
-          logging(WARN, "Failed to parse color from cache file for index %d.",
-                  index);
-        }
+      int r, g, b;
+      if (index >= 0 && index < PALETTE_MAX_SIZE &&
+          sscanf(value, "%d,%d,%d", &r, &g, &b) == 3) {
+        palette->colors[index] = (Color){(uint8_t)r, (uint8_t)g, (uint8_t)b};
+        found++;
       }
     }
   }
-
   fclose(file);
-  logging(INFO, "Found cache: %s", cache_filepath);
+  return found == PALETTE_MAX_SIZE ? 0 : -1;
+}
+
+// Splits the backend off a raw text cache file name, "<image key>_<backend>";
+// the key contains no underscores.
+static const char *split_backend(char *name) {
+  char *end = strchr(name, '_');
+  if (!end || end[1] == '\0')
+    return NULL;
+  *end = '\0';
+  return end + 1;
+}
+
+// Moves one raw text cache file into the store. Older files are named after
+// the wallpaper's basename, newer ones after its key; either way the rest of
+// the name holds the backend.
+static int migrate_cache_file(const char *path, const char *cache_dir) {
+  char wallpaper[MAX_LINE_LENGTH], key[IMAGE_KEY_SIZE];
+  StoredPalette palette;
+  if (parse_cache_file(path, wallpaper, sizeof(wallpaper), &palette) != 0 ||
+      image_key(wallpaper, cache_dir, key) != 0)
+    return -1;
+
+  const char *stem = strrchr(path, '/') + 1;
+  const char *base = strrchr(wallpaper, '/');
+  base = base ? base + 1 : wallpaper;
+  size_t skip;
+  if (strncmp(stem, key, IMAGE_KEY_SIZE - 1) == 0)
+    skip = IMAGE_KEY_SIZE - 1;
+  else if (strncmp(stem, base, strlen(base)) == 0)
+    skip = strlen(base);
+  else
+    return -1;
+
+  char name[PATH_MAX];
+  snprintf(name, sizeof(name), "%s%s", key, stem + skip);
+  char *extension = strrchr(name, '.');
+  if (!extension || strcmp(extension, ".cwal") != 0)
+    return -1;
+  *extension = '\0';
+
+  const char *backend = split_backend(name);
+  if (!backend)
+    return -1;
+  char raw_name[sizeof(name) + 4];
+  snprintf(raw_name, sizeof(raw_name), "raw/%s", name);
+  return store_put(palette_store, hash_string(raw_name, 0),
+                   backend_id(backend), &palette);
+}
+
+// Imports the per-scheme text files the store replaced, then removes them.
+// Files whose image is gone are dropped; they could never be looked up.
+// Processed palettes predate PROCESS_REVISION and are dropped too; they are
+// processed again from the extracted colors.
+static void migrate_text_cache(const char *schemes_dir,
+                               const char *cache_dir) {
+  int migrated = 0;
+  for (int raw = 0; raw <= 1; raw++) {
+    char pattern[PATH_MAX];
+    snprintf(pattern, sizeof(pattern), "%s/%s*.cwal", schemes_dir,
+             raw ? "raw/" : "");
+
+    glob_t results;
+    if (glob(pattern, 0, NULL, &results) == 0) {
+      for (size_t i = 0; i < results.gl_pathc; i++) {
+        if (raw && migrate_cache_file(results.gl_pathv[i], cache_dir) == 0)
+          migrated++;
+        unlink(results.gl_pathv[i]);
+      }
+    }
+    globfree(&results);
+  }
+
+  char raw_dir[PATH_MAX];
+  snprintf(raw_dir, sizeof(raw_dir), "%s/raw", schemes_dir);
+  rmdir(raw_dir);
+  if (migrated > 0)
+    logging(INFO, "Migrated %d cached palettes to the palette store.",
+            migrated);
+}
+
+static PaletteStore *open_palette_store(const char *cache_dir) {
+  if (palette_store)
+    return palette_store;
+
+  char *home_cache = expand_home(cache_dir);
+  char *schemes_dir = build_path(home_cache, "schemes");
+  free(home_cache);
+  if (!schemes_dir)
+    return NULL;
+
+  bool created;
+  palette_store = store_open(schemes_dir, &created);
+  if (palette_store && created)
+    migrate_text_cache(schemes_dir, cache_dir);
+  // Identities and fingerprints used to be kept in text files beside it
+  static const char *legacy_files[] = {"identities", "similar"};
+  for (size_t i = 0; i < sizeof(legacy_files) / sizeof(*legacy_files); i++) {
+    char *legacy_path = build_path(schemes_dir, legacy_files[i]);
+    if (legacy_path)
+      unlink(legacy_path);
+    free(legacy_path);
+  }
+  free(schemes_dir);
+  return palette_store;
+}
+
+void set_shared_palette_cache(const char *dir) {
+  shared_dir = dir && *dir ? dir : NULL;
+}
+
+// Opened for writing when the user may write to it, and read-only otherwise.
+static PaletteStore *open_shared_store(void) {
+  if (shared_opened || !shared_dir)
+    return shared_store;
+  shared_opened = true;
+
+  char *dir = expand_home(shared_dir);
+  char *data_path = build_path(dir, "palettes.db");
+  shared_writable = data_path && access(dir, W_OK) == 0 &&
+                    (access(data_path, W_OK) == 0 || errno == ENOENT);
+  if (shared_writable) {
+    bool created;
+    shared_store = store_open(dir, &created);
+  } else if (dir) {
+    shared_store = store_open_read_only(dir);
+  }
+  if (!shared_store)
+    logging(WARN, "Shared palette cache is unavailable: %s", shared_dir);
+  free(data_path);
+  free(dir);
+  return shared_store;
+}
+
+// New palettes go to a writable shared store, where they help everyone, and
+// to the user's own cache otherwise.
+static PaletteStore *writable_store(const char *cache_dir) {
+  PaletteStore *shared = open_shared_store();
+  return shared && shared_writable ? shared : open_palette_store(cache_dir);
+}
+
+void set_palette_cache_limits(const CacheLimits *limits) {
+  cache_limits = *limits;
+}
+
+static int evict_to_limits(PaletteStore *store) {
+  uint32_t max_entries =
+      cache_limits.max_entries > 0 ? (uint32_t)cache_limits.max_entries : 0;
+  uint64_t max_bytes = cache_limits.max_size_kb > 0
+                           ? (uint64_t)cache_limits.max_size_kb * 1024
+                           : 0;
+  int evicted = store_evict(store, max_entries, max_bytes);
+  if (evicted > 0)
+    logging(INFO, "Evicted %d least recently used cache entries.", evicted);
+  return evicted;
+}
+
+void close_palette_cache(void) {
+  if (palette_store)
+    evict_to_limits(palette_store);
+  store_close(palette_store);
+  palette_store = NULL;
+  store_close(shared_store);
+  shared_store = NULL;
+  shared_opened = false;
+
+  // Closing the file drops its locks, letting waiting processes read the
+  // palettes saved above.
+  if (compute_lock_fd >= 0)
+    close(compute_lock_fd);
+  compute_lock_fd = -1;
+}
+
+int gc_palette_cache(const char *cache_dir) {
+  PaletteStore *store = open_palette_store(cache_dir);
+  if (!store)
+    return -1;
+
+  int evicted = evict_to_limits(store);
+  uint32_t dead = store_dead_records(store);
+  if (evicted < 0 || (dead > 0 && store_compact(store) != 0)) {
+    close_palette_cache();
+    return -1;
+  }
+
+  // Nothing is evicted from the shared store, but its dead records go too
+  PaletteStore *shared = open_shared_store();
+  if (shared && shared_writable && store_dead_records(shared) > 0 &&
+      store_compact(shared) != 0)
+    logging(WARN, "Failed to compact the shared palette cache.");
+
+  logging(INFO, "Palette cache: %u palettes kept, %u reclaimed.",
+          store_live_records(store), dead);
+  close_palette_cache();
+  return 0;
+}
+
+// Extracted colors depend on the dedupe distance, so palettes from other
+// settings are filed apart. Without dedupe the names are the ones from
+// before it existed.
+static void dedupe_suffix(char *buffer, size_t size) {
+  float distance = backend_dedupe_distance();
+  if (distance > 0.0f)
+    snprintf(buffer, size, "_d%.2f", distance);
+  else
+    buffer[0] = '\0';
+}
+
+// Store key of a processed palette: a hash of the name its text cache file
+// used to have, without the backend, plus the processing revision.
+static int palette_key(const Palette *palette, const char *cache_dir,
+                       uint64_t *key) {
+  char image[IMAGE_KEY_SIZE];
+  if (image_key(palette->wallpaper, cache_dir, image) != 0)
+    return -1;
+
+  const char *mode_str = (palette->mode == DARK) ? "dark" : "light";
+  const char *cols16_mode_str =
+      (palette->cols16_mode == DARKEN) ? "darken" : "lighten";
+
+  // HSV has no engine suffix, as before OKLCH existed.
+  const char *engine_str = (palette->engine == ENGINE_OKLCH) ? "_oklch" : "";
+
+  char dedupe[16];
+  dedupe_suffix(dedupe, sizeof(dedupe));
+  char name[MAX_LINE_LENGTH];
+  snprintf(name, sizeof(name), "%s_%s_%s%s_s%.2f_c%.2f_a%.2f%s_p%d", image,
+           mode_str, cols16_mode_str, engine_str, palette->saturation,
+           palette->contrast, palette->alpha, dedupe, PROCESS_REVISION);
+  *key = hash_string(name, 0);
+  return 0;
+}
+
+static int raw_palette_key(const Palette *palette, const char *cache_dir,
+                           uint64_t *key) {
+  char image[IMAGE_KEY_SIZE];
+  if (image_key(palette->wallpaper, cache_dir, image) != 0)
+    return -1;
+
+  char dedupe[16];
+  dedupe_suffix(dedupe, sizeof(dedupe));
+  char name[MAX_LINE_LENGTH];
+  snprintf(name, sizeof(name), "raw/%s%s", image, dedupe);
+  *key = hash_string(name, 0);
   return 0;
 }
+
+// Looks `key` up once for all registered backends, `backend` first and the
+// rest in registration order.
+static ImageBackend *load_preferred(uint64_t key, const char *cache_dir,
+                                    ImageBackend *backend,
+                                    StoredPalette *stored) {
+  ImageBackend **all = get_all_backends();
+  int count = 0;
+  while (all[count])
+    count++;
+
+  ImageBackend **order = malloc((size_t)(count + 1) * sizeof(*order));
+  uint32_t *ids = malloc((size_t)(count + 1) * sizeof(*ids));
+  if (!order || !ids) {
+    free(order);
+    free(ids);
+    return NULL;
+  }
+
+  int n = 0;
+  order[n++] = backend;
+  for (int i = 0; i < count; i++) {
+    if (all[i] != backend)
+      order[n++] = all[i];
+  }
+  for (int i = 0; i < n; i++)
+    ids[i] = backend_id(order[i]->name);
+
+  // The shared store is checked first; the user's own cache is used only when
+  // it has a more preferred backend's palette.
+  int found = store_get(open_shared_store(), key, ids, n, stored);
+  if (found != 0) {
+    StoredPalette own;
+    int own_found = store_get(open_palette_store(cache_dir), key, ids,
+                              found < 0 ? n : found, &own);
+    if (own_found >= 0) {
+      found = own_found;
+      *stored = own;
+    }
+  }
+  ImageBackend *result = found >= 0 ? order[found] : NULL;
+  free(order);
+  free(ids);
+  return result;
+}
+
+int save_palette_to_cache(const Palette *palette, const char *cache_dir,
+                          const char *backend_name) {
+  uint64_t key;
+  if (palette_key(palette, cache_dir, &key) != 0) {
+    logging(ERROR, "Failed to read image for cache key: %s",
+            palette->wallpaper);
+    return -1;
+  }
+
+  PaletteStore *store = writable_store(cache_dir);
+  StoredPalette stored = {.alpha = palette->alpha};
+  memcpy(stored.colors, palette->colors, sizeof(stored.colors));
+  if (store_put(store, key, backend_id(backend_name), &stored) != 0) {
+    logging(ERROR, "Failed to write palette to cache.");
+    return -1;
+  }
+
+  logging(INFO, "Palette saved to cache: %s", palette->wallpaper);
+  return 0;
+}
+
+ImageBackend *load_palette_from_cache(Palette *palette, const char *cache_dir,
+                                      ImageBackend *backend) {
+  uint64_t key;
+  StoredPalette stored;
+  if (palette_key(palette, cache_dir, &key) != 0)
+    return NULL;
+  ImageBackend *found = load_preferred(key, cache_dir, backend, &stored);
+  if (!found)
+    return NULL;
+
+  palette->alpha = stored.alpha;
+  memcpy(palette->colors, stored.colors, sizeof(stored.colors));
+  logging(INFO, "Found cache: %s (%s)", palette->wallpaper, found->name);
+  return found;
+}
+
+// The fingerprint goes in the color bytes of a store record
+static void pack_similar(const SimilarImage *image, StoredPalette *stored) {
+  memset(stored, 0, sizeof(*stored));
+  memcpy(stored->colors, &image->dhash, sizeof(image->dhash));
+  stored->colors[3] = image->average;
+}
+
+static void unpack_similar(uint64_t key, const StoredPalette *stored,
+                           SimilarImage *image) {
+  memcpy(&image->dhash, stored->colors, sizeof(image->dhash));
+  image->average = stored->colors[3];
+  image->raw_key = key;
+}
+
+static bool similar_colors(Color a, Color b) {
+  return abs(a.red - b.red) <= SIMILAR_MAX_COLOR_DIFF &&
+         abs(a.green - b.green) <= SIMILAR_MAX_COLOR_DIFF &&
+         abs(a.blue - b.blue) <= SIMILAR_MAX_COLOR_DIFF;
+}
+
+int save_raw_palette_to_cache(const Palette *palette, const char *cache_dir,
+                              const char *backend_name) {
+  uint64_t key;
+  if (raw_palette_key(palette, cache_dir, &key) != 0)
+    return -1;
+
+  PaletteStore *store = writable_store(cache_dir);
+  StoredPalette stored = {.alpha = palette->alpha};
+  memcpy(stored.colors, palette->colors, sizeof(stored.colors));
+  if (store_put(store, key, backend_id(backend_name), &stored) != 0) {
+    logging(ERROR, "Failed to write raw palette to cache.");
+    return -1;
+  }
+  if (has_pending_similar && pending_similar.raw_key == key) {
+    pack_similar(&pending_similar, &stored);
+    if (store_put(store, key, backend_id(SIMILAR_RECORD), &stored) != 0)
+      logging(WARN, "Failed to record the image's fingerprint.");
+    has_pending_similar = false;
+  }
+
+  logging(INFO, "Raw palette saved to cache: %s", palette->wallpaper);
+  return 0;
+}
+
+int save_palette_variants(Palette *palette, const char *cache_dir,
+                          const char *backend_name) {
+  Palette variants[PALETTE_VARIANTS];
+  int requested = process_color_variants(palette, variants);
+  int status = 0;
+  for (int i = 0; i < PALETTE_VARIANTS; i++) {
+    if (save_palette_to_cache(&variants[i], cache_dir, backend_name) != 0)
+      status = -1;
+  }
+  *palette = variants[requested];
+  return status;
+}
+
+ImageBackend *load_raw_palette_from_cache(Palette *palette,
+                                          const char *cache_dir,
+                                          ImageBackend *backend) {
+  uint64_t key;
+  StoredPalette stored;
+  if (raw_palette_key(palette, cache_dir, &key) != 0)
+    return NULL;
+  ImageBackend *found = load_preferred(key, cache_dir, backend, &stored);
+  if (!found)
+    return NULL;
+
+  memcpy(palette->colors, stored.colors, sizeof(stored.colors));
+  logging(INFO, "Found raw palette cache: %s (%s)", palette->wallpaper,
+          found->name);
+  return found;
+}
+
+typedef struct {
+  SimilarImage self;
+  SimilarImage best;
+  int distance;
+} SimilarSearch;
+
+static int visit_similar(uint64_t key, const StoredPalette *stored,
+                         void *context) {
+  SimilarSearch *search = context;
+  SimilarImage other;
+  unpack_similar(key, stored, &other);
+  int distance = __builtin_popcountll(other.dhash ^ search->self.dhash);
+  if (key != search->self.raw_key && distance < search->distance &&
+      similar_colors(other.average, search->self.average)) {
+    search->best = other;
+    search->distance = distance;
+  }
+  return search->distance == 0; // Nothing beats an exact match
+}
+
+ImageBackend *load_similar_palette_from_cache(Palette *palette,
+                                              const char *cache_dir,
+                                              ImageBackend *backend,
+                                              RawImage **image) {
+  SimilarSearch search = {.distance = SIMILAR_MAX_DISTANCE + 1};
+  if (raw_palette_key(palette, cache_dir, &search.self.raw_key) != 0)
+    return NULL;
+  if (!*image)
+    *image = image_load_from_file(palette->wallpaper);
+  if (image_fingerprint(*image, &search.self.dhash, &search.self.average) != 0)
+    return NULL;
+  pending_similar = search.self;
+  has_pending_similar = true;
+
+  // The closest fingerprint in either store wins; only its palette is loaded
+  uint32_t id = backend_id(SIMILAR_RECORD);
+  store_scan(open_shared_store(), id, visit_similar, &search);
+  if (search.distance > 0)
+    store_scan(open_palette_store(cache_dir), id, visit_similar, &search);
+  if (search.distance > SIMILAR_MAX_DISTANCE)
+    return NULL;
+  StoredPalette stored;
+  ImageBackend *found =
+      load_preferred(search.best.raw_key, cache_dir, backend, &stored);
+  if (!found)
+    return NULL;
+
+  memcpy(palette->colors, stored.colors, sizeof(stored.colors));
+  logging(INFO, "Reusing the palette of a near-identical image: %s (%s)",
+          palette->wallpaper, found->name);
+  // Filed under this image too, so its next lookup is a direct hit
+  if (save_raw_palette_to_cache(palette, cache_dir, found->name) != 0)
+    logging(WARN, "Failed to cache raw palette.");
+  return found;
+}
+
+// Each image maps to one byte of schemes/compute.lock, locked with fcntl so
+// the kernel drops it if the holder dies. Unrelated images rarely share a
+// byte, and then only wait for each other.
+int lock_palette_computation(const Palette *palette, const char *cache_dir) {
+  uint64_t key;
+  if (compute_lock_fd >= 0 || raw_palette_key(palette, cache_dir, &key) != 0)
+    return -1;
+
+  char *home_cache = expand_home(cache_dir);
+  char *lock_path = build_path(home_cache, "schemes/compute.lock");
+  free(home_cache);
+  if (!lock_path)
+    return -1;
+  compute_lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  free(lock_path);
+  if (compute_lock_fd < 0)
+    return -1;
+
+  struct flock range = {
+      .l_type = F_WRLCK,
+      .l_whence = SEEK_SET,
+      .l_start = (off_t)(key % COMPUTE_LOCK_RANGE),
+      .l_len = 1,
+  };
+  struct timespec poll = {0, COMPUTE_POLL_MS * 1000000L};
+  int waited = 0;
+  while (fcntl(compute_lock_fd, F_SETLK, &range) != 0) {
+    if ((errno != EACCES && errno != EAGAIN) || waited >= COMPUTE_WAIT_MS) {
+      if (waited > 0)
+        logging(WARN, "Gave up waiting for another cwal process: %s",
+                palette->wallpaper);
+      close(compute_lock_fd);
+      compute_lock_fd = -1;
+      return -1;
+    }
+    if (waited == 0)
+      logging(INFO, "Waiting for another cwal process to finish: %s",
+              palette->wallpaper);
+    nanosleep(&poll, NULL);
+    waited += COMPUTE_POLL_MS;
+  }
+
+  if (waited == 0)
+    return 0;
+  // The other process has saved its palettes; make them visible here
+  if (palette_store)
+    store_sync(palette_store);
+  if (shared_store)
+    store_sync(shared_store);
+  return 1;
+}
@@ -10,9 +10,60 @@
 
 #pragma once
 
+#include "backends/backend.h"
 #include "core.h"
 
+// Entries live in the palette store under schemes/ and are keyed by the
+// image's content rather than its path: a hash of the file, remembered in the
+// store per device, inode, mtime and size so unchanged files are not read
+// again.
 int save_palette_to_cache(const Palette *palette, const char *cache_dir,
                           const char *backend_name);
-int load_palette_from_cache(Palette *palette, const char *cache_dir,
-                            const char *backend_name);
+// Loads the palette cached for this image and these parameters from
+// `backend`, or failing that from any registered backend in registration
+// order, in a single lookup. Returns the backend that produced it, or NULL.
+ImageBackend *load_palette_from_cache(Palette *palette, const char *cache_dir,
+                                      ImageBackend *backend);
+
+// Raw backend output, before process_colors, keyed by the image and the
+// backend only.
+int save_raw_palette_to_cache(const Palette *palette, const char *cache_dir,
+                              const char *backend_name);
+ImageBackend *load_raw_palette_from_cache(Palette *palette,
+                                          const char *cache_dir,
+                                          ImageBackend *backend);
+// On a raw cache miss: fingerprints the decoded image and loads the raw
+// palette of a cached near-identical one (a resized, re-encoded, or renamed
+// copy). `*image` is decoded here unless the caller has it already, and is
+// left for the backends to reuse. The fingerprint is stored with this
+// image's raw palette when that is saved, so it can serve later copies in
+// turn, and is evicted with it.
+ImageBackend *load_similar_palette_from_cache(Palette *palette,
+                                              const char *cache_dir,
+                                              ImageBackend *backend,
+                                              RawImage **image);
+// Processes raw colors into every mode and cols16 variant and caches them
+// all, so switching them later never reloads the image. `palette` becomes
+// the variant it asked for.
+int save_palette_variants(Palette *palette, const char *cache_dir,
+                          const char *backend_name);
+
+// Makes concurrent processes computing the same image's palette take turns,
+// so the later ones find the first one's result in the cache instead of
+// decoding the image again. Held until close_palette_cache. Returns 1 after
+// waiting for another process, 0 when nobody else was computing it, and -1
+// when the lock is unavailable or the wait timed out.
+int lock_palette_computation(const Palette *palette, const char *cache_dir);
+
+// A palette store in `dir` shared by all users, looked up before the user's
+// own cache. Users who may write to it save new palettes there; for the rest
+// it is read-only. NULL or "" disables it.
+void set_shared_palette_cache(const char *dir);
+
+// Caps applied whenever the palette store is closed or collected
+void set_palette_cache_limits(const CacheLimits *limits);
+// Closes the palette store, evicting least recently used entries over the
+// caps and compacting it when most records are dead.
+void close_palette_cache(void);
+// Evicts down to the caps and compacts away every dead record.
+int gc_palette_cache(const char *cache_dir);
@@ -0,0 +1,203 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "sidecar.h"
+#include "utils/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/xattr.h>
+#endif
+
+#define SIDECAR_XATTR_NAME "user.cwal.palette"
+#define SIDECAR_SUFFIX ".cwal"
+#define SIDECAR_MAX_SIZE 1024
+#define BACKEND_NAME_SIZE 64
+
+static SIDECAR_MODE sidecar_mode = SIDECAR_NONE;
+
+void set_sidecar_mode(SIDECAR_MODE mode) { sidecar_mode = mode; }
+
+// Same key=value lines as the old per-palette cache files, plus the image's
+// size and mtime and the dedupe distance the colors were extracted with:
+//   backend=cwal
+//   size=123456
+//   mtime=1700000000
+//   dedupe=0.05
+//   color0=12,34,56 ... color15=...
+static int format_sidecar(const Palette *palette, const char *backend_name,
+                          const struct stat *st, char *buffer, size_t size) {
+  int len = snprintf(buffer, size,
+                     "backend=%s\nsize=%lld\nmtime=%lld\ndedupe=%.2f\n",
+                     backend_name, (long long)st->st_size,
+                     (long long)st->st_mtime, backend_dedupe_distance());
+  for (int i = 0; i < PALETTE_MAX_SIZE && len > 0 && (size_t)len < size; i++) {
+    const Color *c = &palette->colors[i];
+    len += snprintf(buffer + len, size - len, "color%d=%d,%d,%d\n", i, c->red,
+                    c->green, c->blue);
+  }
+  return len > 0 && (size_t)len < size ? len : -1;
+}
+
+static int parse_sidecar(char *buffer, const struct stat *st, char *backend,
+                         Color colors[PALETTE_MAX_SIZE]) {
+  long long size = -1, mtime = -1;
+  char dedupe[16] = "";
+  int found = 0;
+  backend[0] = '\0';
+  char *saveptr;
+  for (char *line = strtok_r(buffer, "\n", &saveptr); line;
+       line = strtok_r(NULL, "\n", &saveptr)) {
+    char *value = strchr(line, '=');
+    if (!value)
+      continue;
+    *value++ = '\0';
+
+    if (strcmp(line, "backend") == 0) {
+      snprintf(backend, BACKEND_NAME_SIZE, "%s", value);
+    } else if (strcmp(line, "size") == 0) {
+      size = atoll(value);
+    } else if (strcmp(line, "mtime") == 0) {
+      mtime = atoll(value);
+    } else if (strcmp(line, "dedupe") == 0) {
+      snprintf(dedupe, sizeof(dedupe), "%s", value);
+    } else if (strncmp(line, "color", 5) == 0) {
+      int index = atoi(line + 5);
+      int r, g, b;
+      if (index >= 0 && index < PALETTE_MAX_SIZE &&
+          sscanf(value, "%d,%d,%d", &r, &g, &b) == 3) {
+        colors[index] = (Color){(uint8_t)r, (uint8_t)g, (uint8_t)b};
+        found++;
+      }
+    }
+  }
+
+  // A palette for another version of the image, or extracted with another
+  // dedupe distance, is stale
+  char current[16];
+  snprintf(current, sizeof(current), "%.2f", backend_dedupe_distance());
+  if (size != (long long)st->st_size || mtime != (long long)st->st_mtime ||
+      strcmp(dedupe, current) != 0)
+    return -1;
+  return found == PALETTE_MAX_SIZE && backend[0] ? 0 : -1;
+}
+
+static char *sidecar_path(const char *image) {
+  size_t len = strlen(image) + sizeof(SIDECAR_SUFFIX);
+  char *path = malloc(len);
+  if (path)
+    snprintf(path, len, "%s" SIDECAR_SUFFIX, image);
+  return path;
+}
+
+// Reads the attribute, or failing that the sidecar file, into `buffer`.
+static ssize_t read_sidecar(const char *image, char *buffer, size_t size) {
+  ssize_t len = -1;
+#ifdef __linux__
+  len = getxattr(image, SIDECAR_XATTR_NAME, buffer, size - 1);
+#endif
+  if (len < 0) {
+    char *path = sidecar_path(image);
+    int fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    free(path);
+    if (fd < 0)
+      return -1;
+    len = read(fd, buffer, size - 1);
+    close(fd);
+  }
+  if (len >= 0)
+    buffer[len] = '\0';
+  return len;
+}
+
+ImageBackend *load_sidecar_palette(Palette *palette, ImageBackend *backend) {
+  struct stat st;
+  char buffer[SIDECAR_MAX_SIZE];
+  if (!palette->wallpaper || stat(palette->wallpaper, &st) != 0 ||
+      read_sidecar(palette->wallpaper, buffer, sizeof(buffer)) <= 0)
+    return NULL;
+
+  char backend_name[BACKEND_NAME_SIZE];
+  Color colors[PALETTE_MAX_SIZE];
+  if (parse_sidecar(buffer, &st, backend_name, colors) != 0) {
+    logging(INFO, "Ignoring outdated palette shipped with: %s",
+            palette->wallpaper);
+    return NULL;
+  }
+
+  memcpy(palette->colors, colors, sizeof(colors));
+  ImageBackend *found = backend_get(backend_name);
+  logging(INFO, "Found palette shipped with: %s (%s)", palette->wallpaper,
+          backend_name);
+  return found ? found : backend;
+}
+
+// Written under a temporary name and renamed, so readers never see half
+static int write_sidecar_file(const char *image, const char *data, int len) {
+  char *path = sidecar_path(image);
+  if (!path)
+    return -1;
+  char temp[PATH_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+
+  int status = -1;
+  int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    status = write(fd, data, len) == len ? 0 : -1;
+    if (close(fd) != 0)
+      status = -1;
+    if (status == 0)
+      status = rename(temp, path);
+    if (status != 0)
+      unlink(temp);
+  }
+  free(path);
+  return status;
+}
+
+int save_sidecar_palette(const Palette *palette, const char *backend_name) {
+  if (sidecar_mode == SIDECAR_NONE)
+    return 0;
+
+  struct stat st;
+  char buffer[SIDECAR_MAX_SIZE];
+  int len = -1;
+  if (palette->wallpaper && stat(palette->wallpaper, &st) == 0)
+    len = format_sidecar(palette, backend_name, &st, buffer, sizeof(buffer));
+  if (len < 0)
+    return -1;
+
+  int status;
+  if (sidecar_mode == SIDECAR_XATTR) {
+#ifdef __linux__
+    status = setxattr(palette->wallpaper, SIDECAR_XATTR_NAME, buffer,
+                      (size_t)len, 0);
+#else
+    errno = ENOTSUP;
+    status = -1;
+#endif
+  } else {
+    status = write_sidecar_file(palette->wallpaper, buffer, len);
+  }
+
+  if (status != 0) {
+    logging(WARN, "Failed to write palette next to %s: %s", palette->wallpaper,
+            strerror(errno));
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "backends/backend.h"
+#include "core.h"
+
+// Raw palettes shipped with an image, in its user.cwal.palette extended
+// attribute or an <image>.cwal file beside it. They record the image's size
+// and mtime and are ignored once either changes.
+
+// Loads the raw palette shipped with the image, trying the attribute first.
+// Returns the backend that produced it (`backend` when that one is not
+// registered here), or NULL.
+ImageBackend *load_sidecar_palette(Palette *palette, ImageBackend *backend);
+
+void set_sidecar_mode(SIDECAR_MODE mode);
+// Writes the raw palette back in the configured way; a no-op for
+// SIDECAR_NONE.
+int save_sidecar_palette(const Palette *palette, const char *backend_name);
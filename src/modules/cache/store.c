@@ -0,0 +1,892 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "store.h"
+#include "utils/hash.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STORE_MAGIC "CWALPDB1"
+#define INDEX_MAGIC "CWALIDX1"
+#define STORE_VERSION 2
+#define INDEX_MIN_CAPACITY 1024
+#define COMPACT_MIN_DEAD 256 // Superseded records before compaction pays off
+#define EVICT_LOW_WATER 90   // Percent of the cap left after an eviction
+#define STORE_TOMBSTONE 0    // Backend id of a record that drops its key
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t generation; // New on every rewrite, so indexes can tell
+  uint8_t reserved[40];
+} StoreHeader;
+
+typedef struct {
+  uint64_t key;     // Image and parameters, without the backend
+  uint32_t backend; // Caller's id for the backend, or STORE_TOMBSTONE
+  uint32_t prev;    // Previous record under the same key plus one; 0 ends
+  float alpha;
+  uint8_t colors[PALETTE_MAX_SIZE * 3];
+  uint32_t checksum; // Low bits of XXH64 over the fields above
+} StoreRecord;
+
+typedef struct {
+  char magic[8];
+  uint64_t generation; // Of the log this index describes; 0 while building
+  uint32_t capacity;   // Slots, a power of two
+  uint32_t indexed;    // Log records covered
+  uint32_t live;       // Occupied slots, one per key
+  uint32_t dead;       // Records superseded by a later one
+  uint8_t reserved[32];
+} IndexHeader;
+
+// Each slot holds the newest record under its key; records link back to the
+// older ones, so a key's palettes from every backend are one probe away.
+typedef struct {
+  uint64_t key;
+  uint32_t record; // Record number plus one; zero marks an empty slot
+  uint32_t atime;  // Last lookup or write, in seconds since the epoch
+} IndexSlot;
+
+_Static_assert(sizeof(Color) == 3, "Color must be packed RGB");
+_Static_assert(sizeof(StoreHeader) == 64, "StoreHeader must be 64 bytes");
+_Static_assert(sizeof(StoreRecord) == 72, "StoreRecord must be 72 bytes");
+_Static_assert(sizeof(IndexHeader) == 64, "IndexHeader must be 64 bytes");
+_Static_assert(sizeof(IndexSlot) == 16, "IndexSlot must be 16 bytes");
+
+// Writers (appends, index rebuilds, eviction, compaction) hold an flock on
+// palettes.lock. Readers never lock. Records are checksummed and immutable,
+// and rebuilds and compaction replace the log and index by rename. But
+// appends and evictions update the shared index mapping in place, and
+// store_get stamps access times there without the lock. So a reader may
+// probe a slot mid-update: it can miss a key whose slot is being inserted or
+// shifted back by remove_slot, and an access time can land on the wrong
+// slot or be lost. It never returns a wrong palette, because every record
+// found is checked against its checksum and the key looked up. A miss only
+// costs recomputing the palette, and a stray access time only skews LRU
+// order.
+struct PaletteStore {
+  char *data_path;
+  char *index_path;
+  char *lock_path;
+  int data_fd;
+  int index_fd;
+  int lock_fd;
+  const uint8_t *data; // Log mapping, possibly shorter than the log
+  size_t data_size;
+  uint32_t records; // Records in the log
+  uint64_t generation;
+  IndexHeader *index;
+  size_t index_size;
+  uint32_t now; // Access time stamped on the slots this run touches
+  bool read_only; // Opened without write access; never modifies the files
+};
+
+static uint32_t record_checksum(const StoreRecord *record) {
+  return (uint32_t)hash_bytes(record, offsetof(StoreRecord, checksum), 0);
+}
+
+static IndexSlot *index_slots(PaletteStore *store) {
+  return (IndexSlot *)(store->index + 1);
+}
+
+static uint64_t new_generation(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  uint64_t generation = hash_bytes(&now, sizeof(now), (uint64_t)getpid());
+  return generation ? generation : 1;
+}
+
+static uint32_t capacity_for(uint32_t records) {
+  uint32_t capacity = INDEX_MIN_CAPACITY;
+  while ((uint64_t)capacity * 7 < (uint64_t)records * 10)
+    capacity *= 2;
+  return capacity;
+}
+
+static int write_all(int fd, const void *buffer, size_t len, off_t offset) {
+  const uint8_t *p = buffer;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, offset);
+    if (n <= 0)
+      return -1;
+    p += n;
+    len -= (size_t)n;
+    offset += n;
+  }
+  return 0;
+}
+
+static off_t record_offset(uint32_t number) {
+  return (off_t)sizeof(StoreHeader) + (off_t)number * (off_t)sizeof(StoreRecord);
+}
+
+static int write_header(int fd, uint64_t generation) {
+  StoreHeader header = {0};
+  memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+  header.version = STORE_VERSION;
+  header.record_size = sizeof(StoreRecord);
+  header.generation = generation;
+  return write_all(fd, &header, sizeof(header), 0);
+}
+
+static void unmap_data(PaletteStore *store) {
+  if (store->data)
+    munmap((void *)store->data, store->data_size);
+  store->data = NULL;
+  store->data_size = 0;
+}
+
+static int open_flags(const PaletteStore *store) {
+  return store->read_only ? O_RDONLY | O_CLOEXEC
+                          : O_RDWR | O_CREAT | O_CLOEXEC;
+}
+
+// Files that replace others keep their mode, so a group-writable shared
+// store stays writable for the group.
+static int create_replacement(const char *temp, const char *path, int flags) {
+  struct stat st;
+  mode_t mode = stat(path, &st) == 0 ? st.st_mode & 0777 : 0644;
+  int fd = open(temp, flags | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+  if (fd >= 0 && fchmod(fd, mode) != 0) {
+    close(fd);
+    unlink(temp);
+    return -1;
+  }
+  return fd;
+}
+
+static int map_data(PaletteStore *store) {
+  struct stat st;
+  if (fstat(store->data_fd, &st) != 0)
+    return -1;
+  if (store->data && (size_t)st.st_size == store->data_size)
+    return 0;
+  unmap_data(store);
+
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+                    store->data_fd, 0);
+  if (data == MAP_FAILED)
+    return -1;
+  store->data = data;
+  store->data_size = (size_t)st.st_size;
+  store->records =
+      (uint32_t)((store->data_size - sizeof(StoreHeader)) / sizeof(StoreRecord));
+  return 0;
+}
+
+// Reads a record, from the mapping when it covers it. Records whose checksum
+// or key do not match are treated as missing.
+static int read_record(PaletteStore *store, uint32_t number,
+                       StoreRecord *record) {
+  size_t offset = (size_t)record_offset(number);
+  if (offset + sizeof(StoreRecord) <= store->data_size) {
+    memcpy(record, store->data + offset, sizeof(StoreRecord));
+  } else if (pread(store->data_fd, record, sizeof(StoreRecord),
+                   (off_t)offset) != (ssize_t)sizeof(StoreRecord)) {
+    return -1;
+  }
+  return record->checksum == record_checksum(record) ? 0 : -1;
+}
+
+static bool same_file(int fd, const char *path) {
+  struct stat fd_st, path_st;
+  return fd >= 0 && fstat(fd, &fd_st) == 0 && stat(path, &path_st) == 0 &&
+         fd_st.st_dev == path_st.st_dev && fd_st.st_ino == path_st.st_ino;
+}
+
+// Maps the current log, reopening it when another process has renamed a
+// compacted one into place. Returns 1 when the log has no valid header yet,
+// which only a writer may add.
+static int attach_data(PaletteStore *store) {
+  if (!same_file(store->data_fd, store->data_path)) {
+    unmap_data(store);
+    if (store->data_fd >= 0)
+      close(store->data_fd);
+    store->data_fd = open(store->data_path, open_flags(store), 0644);
+    if (store->data_fd < 0)
+      return -1;
+  }
+
+  StoreHeader header;
+  if (pread(store->data_fd, &header, sizeof(header), 0) !=
+          (ssize_t)sizeof(header) ||
+      memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != STORE_VERSION ||
+      header.record_size != sizeof(StoreRecord))
+    return 1;
+  store->generation = header.generation;
+  return map_data(store);
+}
+
+// Starts a new log in place of a missing or unreadable one. Writers only.
+static int init_data(PaletteStore *store, bool *created) {
+  struct stat st;
+  if (fstat(store->data_fd, &st) != 0)
+    return -1;
+  if (st.st_size > 0)
+    logging(WARN, "Palette store is unreadable, starting a new one: %s",
+            store->data_path);
+
+  unmap_data(store);
+  store->generation = new_generation();
+  if (ftruncate(store->data_fd, 0) != 0 ||
+      write_header(store->data_fd, store->generation) != 0)
+    return -1;
+  *created = true;
+  return map_data(store);
+}
+
+// The slot holding `key`, or the empty slot where it would go
+static IndexSlot *find_slot(PaletteStore *store, uint64_t key) {
+  IndexSlot *slots = index_slots(store);
+  uint32_t mask = store->index->capacity - 1;
+  uint32_t i = (uint32_t)key & mask;
+  while (slots[i].record != 0 && slots[i].key != key)
+    i = (i + 1) & mask;
+  return &slots[i];
+}
+
+// Steps to the next older record under the same key. Links only ever point
+// backward, so a corrupt one cannot make a walk loop.
+static bool chain_next(PaletteStore *store, uint32_t *number,
+                       StoreRecord *record) {
+  if (record->prev == 0 || record->prev - 1 >= *number)
+    return false;
+  uint64_t key = record->key;
+  *number = record->prev - 1;
+  return read_record(store, *number, record) == 0 && record->key == key;
+}
+
+static bool chain_has_backend(PaletteStore *store, uint32_t number,
+                              uint64_t key, uint32_t backend) {
+  StoreRecord record;
+  if (read_record(store, number, &record) != 0 || record.key != key)
+    return false;
+  do {
+    if (record.backend == backend)
+      return true;
+  } while (chain_next(store, &number, &record));
+  return false;
+}
+
+// Collects the latest record from each backend under the key whose newest
+// record is `number`, newest first. Returns how many were collected.
+static int collect_chain(PaletteStore *store, uint32_t number,
+                         StoreRecord **chain, int *capacity) {
+  StoreRecord record;
+  if (read_record(store, number, &record) != 0)
+    return 0;
+
+  int count = 0;
+  do {
+    bool seen = false;
+    for (int i = 0; i < count && !seen; i++)
+      seen = (*chain)[i].backend == record.backend;
+    if (seen)
+      continue;
+
+    if (count == *capacity) {
+      int grown = *capacity ? *capacity * 2 : 8;
+      StoreRecord *larger = realloc(*chain, (size_t)grown * sizeof(StoreRecord));
+      if (!larger)
+        return -1;
+      *chain = larger;
+      *capacity = grown;
+    }
+    (*chain)[count++] = record;
+  } while (chain_next(store, &number, &record));
+  return count;
+}
+
+// Live records under a key: the newest one from each backend
+static uint32_t chain_live(PaletteStore *store, uint32_t number) {
+  StoreRecord *chain = NULL;
+  int capacity = 0;
+  int count = collect_chain(store, number, &chain, &capacity);
+  free(chain);
+  return count > 0 ? (uint32_t)count : 0;
+}
+
+// Empties a slot, shifting later entries of its probe run back so lookups
+// never need tombstones in the index.
+static void remove_slot(PaletteStore *store, IndexSlot *slot) {
+  IndexSlot *slots = index_slots(store);
+  uint32_t mask = store->index->capacity - 1;
+  uint32_t hole = (uint32_t)(slot - slots);
+  for (uint32_t i = (hole + 1) & mask; slots[i].record != 0;
+       i = (i + 1) & mask) {
+    uint32_t home = (uint32_t)slots[i].key & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots[hole] = slots[i];
+      hole = i;
+    }
+  }
+  slots[hole] = (IndexSlot){0};
+  store->index->live--;
+}
+
+static void index_insert(PaletteStore *store, const StoreRecord *record,
+                         uint32_t number) {
+  IndexSlot *slot = find_slot(store, record->key);
+  if (record->backend == STORE_TOMBSTONE) {
+    store->index->dead++;
+    if (slot->record != 0) {
+      store->index->dead += chain_live(store, slot->record - 1);
+      remove_slot(store, slot);
+    }
+    return;
+  }
+
+  if (slot->record == 0) {
+    slot->key = record->key;
+    store->index->live++;
+  } else if (chain_has_backend(store, slot->record - 1, record->key,
+                               record->backend)) {
+    store->index->dead++;
+  }
+  slot->record = number + 1;
+  slot->atime = store->now;
+}
+
+static void index_records(PaletteStore *store, uint32_t from) {
+  for (uint32_t number = from; number < store->records; number++) {
+    StoreRecord record;
+    if (read_record(store, number, &record) == 0)
+      index_insert(store, &record, number);
+  }
+  store->index->indexed = store->records;
+}
+
+static void unmap_index(PaletteStore *store) {
+  if (store->index)
+    munmap(store->index, store->index_size);
+  store->index = NULL;
+  store->index_size = 0;
+}
+
+// Access times of the keys in a mapped index, so a rebuild keeps the LRU
+// order. Returns how many slots were saved.
+static uint32_t save_access_times(PaletteStore *store, IndexSlot **saved) {
+  *saved = NULL;
+  IndexHeader *header = store->index;
+  if (!header || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) ||
+      store->index_size != sizeof(IndexHeader) +
+                                (size_t)header->capacity * sizeof(IndexSlot))
+    return 0;
+
+  *saved = malloc(((size_t)header->live + 1) * sizeof(IndexSlot));
+  if (!*saved)
+    return 0;
+  uint32_t count = 0;
+  IndexSlot *slots = index_slots(store);
+  for (uint32_t i = 0; i < header->capacity && count < header->live; i++) {
+    if (slots[i].record != 0)
+      (*saved)[count++] = slots[i];
+  }
+  return count;
+}
+
+// Swaps in `index`, a zeroed mapping backed by `fd` (or anonymous, with
+// -1), and fills it from the whole log, keeping the old one's access times.
+static void install_index(PaletteStore *store, void *index, size_t size,
+                          int fd, uint32_t capacity) {
+  IndexSlot *saved;
+  uint32_t saved_count = save_access_times(store, &saved);
+  unmap_index(store);
+  if (store->index_fd >= 0)
+    close(store->index_fd);
+  store->index_fd = fd;
+  store->index = index;
+  store->index_size = size;
+
+  memcpy(store->index->magic, INDEX_MAGIC, sizeof(store->index->magic));
+  store->index->capacity = capacity;
+  store->index->generation = store->generation;
+  index_records(store, 0);
+  for (uint32_t i = 0; i < saved_count; i++) {
+    IndexSlot *slot = find_slot(store, saved[i].key);
+    if (slot->record != 0)
+      slot->atime = saved[i].atime;
+  }
+  free(saved);
+}
+
+// Builds a fresh index from the whole log under a temporary name and renames
+// it into place, so processes still reading the old one are never cut off.
+static int rebuild_index(PaletteStore *store, uint32_t capacity) {
+  char temp[PATH_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", store->index_path,
+           (long)getpid());
+  size_t size = sizeof(IndexHeader) + (size_t)capacity * sizeof(IndexSlot);
+  int fd = create_replacement(temp, store->index_path, O_RDWR);
+  void *index = MAP_FAILED;
+  if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+    index = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (index == MAP_FAILED) {
+    if (fd >= 0) {
+      close(fd);
+      unlink(temp);
+    }
+    return -1;
+  }
+
+  install_index(store, index, size, fd, capacity);
+  if (rename(temp, store->index_path) != 0) {
+    unlink(temp);
+    return -1;
+  }
+  return 0;
+}
+
+// Maps the current index, reopening it when another process has renamed a
+// rebuilt one into place. Returns 1 when it does not describe the mapped log
+// and a writer has to rebuild it.
+static int attach_index(PaletteStore *store) {
+  if (!same_file(store->index_fd, store->index_path)) {
+    unmap_index(store);
+    if (store->index_fd >= 0)
+      close(store->index_fd);
+    store->index_fd = open(store->index_path, open_flags(store), 0644);
+    if (store->index_fd < 0)
+      return store->read_only && errno == ENOENT ? 1 : -1;
+
+    struct stat st;
+    if (fstat(store->index_fd, &st) != 0)
+      return -1;
+    if (st.st_size >= (off_t)sizeof(IndexHeader)) {
+      int prot = store->read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+      void *index = mmap(NULL, (size_t)st.st_size, prot, MAP_SHARED,
+                         store->index_fd, 0);
+      if (index != MAP_FAILED) {
+        store->index = index;
+        store->index_size = (size_t)st.st_size;
+      }
+    }
+  }
+
+  IndexHeader *header = store->index;
+  bool valid =
+      header && memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+      header->generation == store->generation && header->capacity > 0 &&
+      (header->capacity & (header->capacity - 1)) == 0 &&
+      store->index_size == sizeof(IndexHeader) +
+                               (size_t)header->capacity * sizeof(IndexSlot) &&
+      header->indexed <= store->records;
+  return valid ? 0 : 1;
+}
+
+// A read-only store whose index is missing or behind its log indexes the log
+// in private memory instead, since it cannot fix the file.
+static int index_privately(PaletteStore *store) {
+  uint32_t capacity = capacity_for(store->records);
+  size_t size = sizeof(IndexHeader) + (size_t)capacity * sizeof(IndexSlot);
+  void *index = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (index == MAP_FAILED)
+    return -1;
+  install_index(store, index, size, -1, capacity);
+  return 0;
+}
+
+static int lock_store(PaletteStore *store) {
+  while (flock(store->lock_fd, LOCK_EX) != 0) {
+    if (errno != EINTR)
+      return -1;
+  }
+  return 0;
+}
+
+static void unlock_store(PaletteStore *store) {
+  flock(store->lock_fd, LOCK_UN);
+}
+
+// Brings this process's view up to date before a write: a log or index
+// another process replaced, records it appended, and a record torn by a
+// crash. Called with the lock held, so no append is in flight.
+static int refresh_store(PaletteStore *store, bool *created) {
+  int status = attach_data(store);
+  if (status == 1)
+    status = init_data(store, created);
+  if (status != 0)
+    return -1;
+
+  off_t whole = record_offset(store->records);
+  if ((off_t)store->data_size > whole &&
+      (ftruncate(store->data_fd, whole) != 0 || map_data(store) != 0))
+    return -1;
+
+  status = attach_index(store);
+  if (status < 0)
+    return -1;
+  IndexHeader *header = store->index;
+  if (status == 1 ||
+      (uint64_t)(header->live + store->records - header->indexed) * 10 >
+          (uint64_t)header->capacity * 7)
+    return rebuild_index(store, capacity_for(store->records));
+  index_records(store, header->indexed);
+  return 0;
+}
+
+// Picks up changes other processes made since the store was opened, locking
+// only when the files need repairing.
+static int sync_store(PaletteStore *store, bool *created) {
+  int status = attach_data(store);
+  if (status == 1 && store->read_only)
+    return -1;
+  if (status == 0)
+    status = attach_index(store);
+  if (status == 0 && store->index->indexed != store->records)
+    status = 1;
+  if (status == 1 && store->read_only) {
+    status = index_privately(store);
+  } else if (status == 1 && lock_store(store) == 0) {
+    status = refresh_store(store, created);
+    unlock_store(store);
+  }
+  return status;
+}
+
+static PaletteStore *new_store(const char *dir, bool read_only) {
+  PaletteStore *store = calloc(1, sizeof(PaletteStore));
+  if (!store)
+    return NULL;
+  store->data_fd = -1;
+  store->index_fd = -1;
+  store->lock_fd = -1;
+  store->read_only = read_only;
+  store->now = (uint32_t)time(NULL);
+  store->data_path = build_path(dir, "palettes.db");
+  store->index_path = build_path(dir, "palettes.idx");
+  store->lock_path = build_path(dir, "palettes.lock");
+  if (!store->data_path || !store->index_path || !store->lock_path) {
+    store_close(store);
+    return NULL;
+  }
+  return store;
+}
+
+PaletteStore *store_open(const char *dir, bool *created) {
+  *created = false;
+  if (validate_or_create_dir(dir) != 0) {
+    logging(ERROR, "Failed to create cache directory: %s", dir);
+    return NULL;
+  }
+
+  PaletteStore *store = new_store(dir, false);
+  if (!store)
+    return NULL;
+  // flock needs no write access, so group members share one lock file
+  store->lock_fd =
+      open(store->lock_path, O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+
+  if (store->lock_fd < 0 || sync_store(store, created) != 0) {
+    logging(ERROR, "Failed to open palette store: %s", dir);
+    *created = false;
+    store_close(store);
+    return NULL;
+  }
+  return store;
+}
+
+PaletteStore *store_open_read_only(const char *dir) {
+  PaletteStore *store = new_store(dir, true);
+  bool created = false;
+  if (store && sync_store(store, &created) != 0) {
+    store_close(store);
+    return NULL;
+  }
+  return store;
+}
+
+int store_sync(PaletteStore *store) {
+  bool created = false;
+  return store && sync_store(store, &created) == 0 ? 0 : -1;
+}
+
+int store_get(PaletteStore *store, uint64_t key, const uint32_t *backends,
+              int count, StoredPalette *palette) {
+  if (!store || !store->index)
+    return -1;
+
+  IndexSlot *slot = find_slot(store, key);
+  uint32_t number = slot->record - 1;
+  StoreRecord record, found;
+  if (slot->record == 0 || read_record(store, number, &record) != 0 ||
+      record.key != key)
+    return -1;
+
+  // Newer records come first, so the first match for a backend is its latest
+  int best = -1;
+  do {
+    for (int i = 0; i < (best < 0 ? count : best); i++) {
+      if (backends[i] == record.backend) {
+        best = i;
+        found = record;
+        break;
+      }
+    }
+  } while (best != 0 && chain_next(store, &number, &record));
+
+  if (best < 0)
+    return -1;
+  if (!store->read_only)
+    slot->atime = store->now;
+  palette->alpha = found.alpha;
+  memcpy(palette->colors, found.colors, sizeof(found.colors));
+  return best;
+}
+
+int store_scan(PaletteStore *store, uint32_t backend, StoreVisitor visit,
+               void *context) {
+  if (!store || !store->index)
+    return -1;
+
+  IndexSlot *slots = index_slots(store);
+  for (uint32_t i = 0; i < store->index->capacity; i++) {
+    uint32_t number = slots[i].record - 1;
+    StoreRecord record;
+    if (slots[i].record == 0 || read_record(store, number, &record) != 0 ||
+        record.key != slots[i].key)
+      continue;
+    do {
+      if (record.backend != backend)
+        continue;
+      StoredPalette palette = {.alpha = record.alpha};
+      memcpy(palette.colors, record.colors, sizeof(record.colors));
+      if (visit(record.key, &palette, context) != 0)
+        return 0;
+      break;
+    } while (chain_next(store, &number, &record));
+  }
+  return 0;
+}
+
+// Each record goes out in one write at the end of the log; one cut short is
+// truncated away here, or by the next writer if the process died first.
+static int append_record(PaletteStore *store, StoreRecord *record) {
+  record->prev = find_slot(store, record->key)->record;
+  record->checksum = record_checksum(record);
+
+  off_t end = record_offset(store->records);
+  if (write_all(store->data_fd, record, sizeof(*record), end) != 0) {
+    if (ftruncate(store->data_fd, end) != 0)
+      logging(WARN, "Failed to drop torn record: %s", store->data_path);
+    return -1;
+  }
+  uint32_t number = store->records++;
+
+  if ((uint64_t)(store->index->live + 1) * 10 >
+      (uint64_t)store->index->capacity * 7) {
+    uint32_t capacity = capacity_for(store->records);
+    if (capacity <= store->index->capacity)
+      capacity = store->index->capacity * 2;
+    return map_data(store) == 0 ? rebuild_index(store, capacity) : -1;
+  }
+
+  index_insert(store, record, number);
+  store->index->indexed = store->records;
+  return 0;
+}
+
+int store_put(PaletteStore *store, uint64_t key, uint32_t backend,
+              const StoredPalette *palette) {
+  if (!store || !store->index || store->read_only ||
+      backend == STORE_TOMBSTONE)
+    return -1;
+
+  StoreRecord record = {0};
+  record.key = key;
+  record.backend = backend;
+  record.alpha = palette->alpha;
+  memcpy(record.colors, palette->colors, sizeof(record.colors));
+
+  if (lock_store(store) != 0)
+    return -1;
+  bool created = false;
+  int status =
+      refresh_store(store, &created) == 0 ? append_record(store, &record) : -1;
+  unlock_store(store);
+  return status;
+}
+
+typedef struct {
+  uint64_t key;
+  uint32_t atime;
+  uint32_t records;
+} EvictCandidate;
+
+static int compare_candidates(const void *a, const void *b) {
+  uint32_t x = ((const EvictCandidate *)a)->atime;
+  uint32_t y = ((const EvictCandidate *)b)->atime;
+  return (x > y) - (x < y);
+}
+
+static int evict_records(PaletteStore *store, uint32_t max_records,
+                         uint64_t max_bytes) {
+  // Compaction shrinks the log to its live records, so bytes map to records
+  if (max_bytes > 0) {
+    uint64_t fit = max_bytes > sizeof(StoreHeader)
+                       ? (max_bytes - sizeof(StoreHeader)) / sizeof(StoreRecord)
+                       : 0;
+    if (max_records == 0 || fit < max_records)
+      max_records = (uint32_t)(fit < UINT32_MAX ? fit : UINT32_MAX);
+  } else if (max_records == 0) {
+    return 0;
+  }
+
+  uint32_t live = store->records - store->index->dead;
+  if (live <= max_records)
+    return 0;
+
+  uint32_t count = 0;
+  EvictCandidate *candidates =
+      malloc(((size_t)store->index->live + 1) * sizeof(EvictCandidate));
+  if (!candidates)
+    return -1;
+  IndexSlot *slots = index_slots(store);
+  for (uint32_t i = 0; i < store->index->capacity; i++) {
+    if (slots[i].record != 0 && count < store->index->live) {
+      candidates[count++] = (EvictCandidate){
+          slots[i].key, slots[i].atime, chain_live(store, slots[i].record - 1)};
+    }
+  }
+  qsort(candidates, count, sizeof(EvictCandidate), compare_candidates);
+
+  // Going below the cap spaces out the evictions that follow
+  uint32_t target = (uint32_t)((uint64_t)max_records * EVICT_LOW_WATER / 100);
+  int evicted = 0;
+  for (uint32_t i = 0; i < count && live > target; i++) {
+    StoreRecord tombstone = {.key = candidates[i].key,
+                             .backend = STORE_TOMBSTONE};
+    if (append_record(store, &tombstone) != 0) {
+      free(candidates);
+      return -1;
+    }
+    live -= candidates[i].records;
+    evicted++;
+  }
+  free(candidates);
+  return evicted;
+}
+
+int store_evict(PaletteStore *store, uint32_t max_records, uint64_t max_bytes) {
+  if (!store || !store->index || store->read_only || lock_store(store) != 0)
+    return -1;
+  bool created = false;
+  int evicted = refresh_store(store, &created) == 0
+                    ? evict_records(store, max_records, max_bytes)
+                    : -1;
+  unlock_store(store);
+  return evicted;
+}
+
+static int compact_records(PaletteStore *store) {
+  char temp[PATH_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", store->data_path,
+           (long)getpid());
+
+  // Each key's live records are written oldest first and relinked
+  uint64_t generation = new_generation();
+  int fd = create_replacement(temp, store->data_path, O_WRONLY);
+  int status = fd >= 0 ? write_header(fd, generation) : -1;
+  StoreRecord *chain = NULL;
+  int chain_capacity = 0;
+  uint32_t written = 0;
+  IndexSlot *slots = index_slots(store);
+  for (uint32_t i = 0; status == 0 && i < store->index->capacity; i++) {
+    if (slots[i].record == 0)
+      continue;
+    int count = collect_chain(store, slots[i].record - 1, &chain,
+                              &chain_capacity);
+    if (count < 0)
+      status = -1;
+
+    uint32_t prev = 0;
+    for (int j = count - 1; status == 0 && j >= 0; j--) {
+      chain[j].prev = prev;
+      chain[j].checksum = record_checksum(&chain[j]);
+      status = write_all(fd, &chain[j], sizeof(StoreRecord),
+                         record_offset(written));
+      prev = ++written;
+    }
+  }
+  free(chain);
+
+  if (status == 0)
+    status = fsync(fd);
+  if (fd >= 0 && close(fd) != 0)
+    status = -1;
+  if (status == 0)
+    status = rename(temp, store->data_path);
+  if (status != 0) {
+    logging(ERROR, "Failed to compact palette store: %s", store->data_path);
+    unlink(temp);
+    return -1;
+  }
+
+  // Switch to the rewritten log
+  if (attach_data(store) != 0)
+    return -1;
+  return rebuild_index(store, capacity_for(store->records));
+}
+
+int store_compact(PaletteStore *store) {
+  if (!store || !store->index || store->read_only || lock_store(store) != 0)
+    return -1;
+  bool created = false;
+  int status =
+      refresh_store(store, &created) == 0 ? compact_records(store) : -1;
+  unlock_store(store);
+  return status;
+}
+
+uint32_t store_live_records(const PaletteStore *store) {
+  return store && store->index ? store->records - store->index->dead : 0;
+}
+
+uint32_t store_dead_records(const PaletteStore *store) {
+  return store && store->index ? store->index->dead : 0;
+}
+
+void store_close(PaletteStore *store) {
+  if (!store)
+    return;
+
+  uint32_t dead = store_dead_records(store);
+  if (dead >= COMPACT_MIN_DEAD && dead > store_live_records(store))
+    store_compact(store);
+
+  unmap_index(store);
+  unmap_data(store);
+  if (store->index_fd >= 0)
+    close(store->index_fd);
+  if (store->data_fd >= 0)
+    close(store->data_fd);
+  if (store->lock_fd >= 0)
+    close(store->lock_fd);
+  free(store->lock_path);
+  free(store->index_path);
+  free(store->data_path);
+  free(store);
+}
@@ -0,0 +1,67 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "core.h"
+#include <stdint.h>
+
+// Append-only palette store: a log of fixed-size checksummed records
+// (palettes.db) and an mmap'd open-addressing index over it (palettes.idx).
+// The index is derived data; it is rebuilt from the log whenever it is
+// missing, stale or torn.
+//
+// Records are filed under a key and a nonzero backend id. One key holds a
+// palette per backend, and a lookup picks among them by preference in one
+// probe. The index also keeps each key's last access time for LRU eviction.
+typedef struct PaletteStore PaletteStore;
+
+typedef struct {
+  float alpha;
+  Color colors[PALETTE_MAX_SIZE];
+} StoredPalette;
+
+// Opens or creates the store in `dir`. `created` is set when the log did not
+// exist before.
+PaletteStore *store_open(const char *dir, bool *created);
+// Opens an existing store without modifying it, for stores the user may not
+// write to. Lookups work as usual; writes fail, and access times are not
+// recorded.
+PaletteStore *store_open_read_only(const char *dir);
+// Compacts the log first when most of its records are superseded.
+void store_close(PaletteStore *store);
+// Catches up with palettes other processes stored since the store was opened.
+int store_sync(PaletteStore *store);
+
+// Finds the palette under `key` from the earliest backend in `backends` that
+// has one. Returns that backend's position in the array, or -1.
+int store_get(PaletteStore *store, uint64_t key, const uint32_t *backends,
+              int count, StoredPalette *palette);
+// Calls `visit` with each key's latest record from `backend`, in index order,
+// until it returns nonzero. Like store_get it takes no lock, so keys another
+// process is adding may be missed.
+typedef int (*StoreVisitor)(uint64_t key, const StoredPalette *palette,
+                            void *context);
+int store_scan(PaletteStore *store, uint32_t backend, StoreVisitor visit,
+               void *context);
+// Appends a record; it replaces any earlier one for the same key and backend.
+int store_put(PaletteStore *store, uint64_t key, uint32_t backend,
+              const StoredPalette *palette);
+// Rewrites the log with only the live records and rebuilds the index.
+int store_compact(PaletteStore *store);
+
+// Palettes that are neither superseded nor evicted, and those that are
+uint32_t store_live_records(const PaletteStore *store);
+uint32_t store_dead_records(const PaletteStore *store);
+// Drops the least recently used keys, with all their backends' palettes,
+// once the live palettes exceed `max_records` or, compacted, `max_bytes`
+// (0 disables either cap). It evicts down to 90% of the cap so the next runs
+// do not have to. Returns the keys dropped.
+int store_evict(PaletteStore *store, uint32_t max_records, uint64_t max_bytes);
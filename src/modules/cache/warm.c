@@ -0,0 +1,160 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "warm.h"
+#include "cache.h"
+#include "sidecar.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+#endif
+
+#define WARM_NICE 19
+
+// Shared by the workers. Each takes the next image from the cursor, so a
+// worker stuck on a large image never holds up the rest of the queue.
+typedef struct {
+  atomic_int next;
+  atomic_int computed;
+  atomic_int cached;
+  atomic_int failed;
+} WarmProgress;
+
+static void lower_priority(void) {
+  if (setpriority(PRIO_PROCESS, 0, WARM_NICE) != 0)
+    logging(WARN, "Failed to lower CPU priority for warming.");
+#ifdef __linux__
+  if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+              IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+    logging(WARN, "Failed to lower I/O priority for warming.");
+#endif
+}
+
+// Same steps as a normal run: the processed cache, then the raw cache and
+// near-identical images, then the backends.
+static void warm_image(char *path, const Palette *params, ImageBackend *backend,
+                       const char *cache_dir, WarmProgress *progress) {
+  Palette palette = *params;
+  palette.wallpaper = path;
+  if (load_sidecar_palette(&palette, backend) ||
+      load_palette_from_cache(&palette, cache_dir, backend)) {
+    atomic_fetch_add(&progress->cached, 1);
+    return;
+  }
+
+  ImageBackend *used_backend =
+      load_raw_palette_from_cache(&palette, cache_dir, backend);
+  RawImage *image = NULL;
+  if (!used_backend)
+    used_backend =
+        load_similar_palette_from_cache(&palette, cache_dir, backend, &image);
+  if (!used_backend) {
+    if (process_with_fallback(backend, path, &image, &palette,
+                              &used_backend) != 0) {
+      image_free(image);
+      logging(WARN, "Failed to warm: %s", path);
+      atomic_fetch_add(&progress->failed, 1);
+      return;
+    }
+    if (save_raw_palette_to_cache(&palette, cache_dir, used_backend->name) !=
+        0)
+      logging(WARN, "Failed to cache raw palette.");
+    save_sidecar_palette(&palette, used_backend->name);
+  }
+  image_free(image);
+
+  if (save_palette_variants(&palette, cache_dir, used_backend->name) != 0) {
+    atomic_fetch_add(&progress->failed, 1);
+    return;
+  }
+  atomic_fetch_add(&progress->computed, 1);
+}
+
+static void run_worker(char **images, int count, const Palette *params,
+                       ImageBackend *backend, const char *cache_dir,
+                       WarmProgress *progress) {
+  int i;
+  while ((i = atomic_fetch_add(&progress->next, 1)) < count)
+    warm_image(images[i], params, backend, cache_dir, progress);
+  close_palette_cache();
+}
+
+int warm_palette_cache(const char *directory, const Palette *params,
+                       ImageBackend *backend, const char *cache_dir) {
+  int count;
+  char **images = list_image_files(directory, &count);
+  if (!images)
+    return -1;
+
+  WarmProgress *progress = mmap(NULL, sizeof(WarmProgress),
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (progress == MAP_FAILED) {
+    free_image_files(images, count);
+    return -1;
+  }
+  atomic_init(&progress->next, 0);
+  atomic_init(&progress->computed, 0);
+  atomic_init(&progress->cached, 0);
+  atomic_init(&progress->failed, 0);
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int workers = cpus > 0 && cpus < count ? (int)cpus : count;
+  logging(INFO, "Warming %d images with %d workers: %s", count, workers,
+          directory);
+  lower_priority();
+
+  // Workers are processes: backends and the Lua states are per process, and
+  // the palette store is already safe to share between processes. Each opens
+  // its own store, since descriptors shared across fork share their locks.
+  close_palette_cache();
+  int started = 0;
+  for (; started < workers; started++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      logging(WARN, "Failed to start warming worker.");
+      break;
+    }
+    if (pid == 0) {
+      run_worker(images, count, params, backend, cache_dir, progress);
+      _exit(0);
+    }
+  }
+  if (started == 0)
+    run_worker(images, count, params, backend, cache_dir, progress);
+
+  int crashed = 0;
+  int status;
+  while (wait(&status) > 0) {
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      crashed++;
+  }
+  if (crashed > 0)
+    logging(WARN, "%d warming workers exited abnormally.", crashed);
+
+  int failed = atomic_load(&progress->failed);
+  logging(INFO, "Warmed %d images: %d computed, %d already cached, %d failed.",
+          count, atomic_load(&progress->computed),
+          atomic_load(&progress->cached), failed);
+  munmap(progress, sizeof(WarmProgress));
+  free_image_files(images, count);
+  return failed;
+}
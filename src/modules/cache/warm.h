@@ -0,0 +1,22 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "backends/backend.h"
+#include "core.h"
+
+// Caches the palettes of every image in `directory` for the parameters in
+// `params`, in all modes and cols16 modes, skipping images already cached.
+// Images are handed out to one worker process per CPU, run at idle CPU and
+// I/O priority. Interrupted runs resume where they stopped, since finished
+// images are cache hits. Returns the images that failed, or -1.
+int warm_palette_cache(const char *directory, const Palette *params,
+                       ImageBackend *backend, const char *cache_dir);
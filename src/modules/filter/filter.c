@@ -0,0 +1,133 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#include "filter.h"
+#include "backends/lua_vm.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+#include <glob.h>
+#include <lauxlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PALETTE_CAST_KEY "cwal.palette_cast"
+
+// The FFI declaration below mirrors Palette; keep the two in sync.
+_Static_assert(sizeof(COLOR_MODE) == sizeof(int), "COLOR_MODE must be int");
+_Static_assert(sizeof(SHADE_MODE) == sizeof(int), "SHADE_MODE must be int");
+_Static_assert(sizeof(COLOR_ENGINE) == sizeof(int), "COLOR_ENGINE must be int");
+_Static_assert(sizeof(Color) == 3, "Color must be packed RGB");
+
+static const char *palette_cast_source =
+    "local ffi = require('ffi')\n"
+    "ffi.cdef[[\n"
+    "typedef struct { uint8_t r, g, b; } cwal_color;\n"
+    "typedef struct {\n"
+    "  const char *wallpaper;\n"
+    "  cwal_color colors[16];\n"
+    "  float saturation, contrast, alpha;\n"
+    "  int cols16_mode, mode, engine;\n"
+    "} cwal_palette;\n"
+    "]]\n"
+    "local palette_ptr = ffi.typeof('cwal_palette *')\n"
+    "return function(p) return ffi.cast(palette_ptr, p) end\n";
+
+// Pushes the function that turns a Palette pointer into an FFI struct,
+// declaring the types the first time on this state.
+static int push_palette_cast(lua_State *L) {
+  lua_getfield(L, LUA_REGISTRYINDEX, PALETTE_CAST_KEY);
+  if (lua_isfunction(L, -1))
+    return 0;
+  lua_pop(L, 1);
+
+  if (luaL_loadstring(L, palette_cast_source) != LUA_OK ||
+      lua_pcall(L, 0, 1, 0) != LUA_OK) {
+    logging(ERROR, "Failed to set up palette filters: %s",
+            lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return -1;
+  }
+  lua_pushvalue(L, -1);
+  lua_setfield(L, LUA_REGISTRYINDEX, PALETTE_CAST_KEY);
+  return 0;
+}
+
+static int call_filter(lua_State *L, const char *path, Palette *palette) {
+  int top = lua_gettop(L);
+  if (lua_vm_push_script(path) != 0)
+    return -1;
+
+  lua_getfield(L, -1, "Filter");
+  if (!lua_isfunction(L, -1)) {
+    logging(ERROR, "Filter script must define Filter(palette): %s", path);
+    lua_settop(L, top);
+    return -1;
+  }
+
+  if (push_palette_cast(L) != 0) {
+    lua_settop(L, top);
+    return -1;
+  }
+  lua_pushlightuserdata(L, palette);
+  if (lua_pcall(L, 1, 1, 0) != LUA_OK ||
+      lua_pcall(L, 1, 0, 0) != LUA_OK) {
+    logging(ERROR, "Failed to run filter %s: %s", path, lua_tostring(L, -1));
+    lua_settop(L, top);
+    return -1;
+  }
+
+  lua_settop(L, top);
+  return 0;
+}
+
+static void run_filter(const char *path, Palette *palette,
+                       const LuaLimits *limits) {
+  lua_State *L = lua_vm_state();
+  if (!L)
+    return;
+
+  Palette before = *palette;
+  if (limits)
+    lua_vm_begin_run(limits);
+  int status = call_filter(L, path, palette);
+  const char *exceeded = lua_vm_end_run();
+  if (exceeded) {
+    logging(ERROR, "Filter %s stopped: %s exceeded.", path, exceeded);
+    status = -1;
+  }
+
+  if (status != 0) {
+    *palette = before;
+    return;
+  }
+  // The wallpaper is owned by the caller; filters may only read it.
+  palette->wallpaper = before.wallpaper;
+}
+
+void apply_palette_filters(Palette *palette, const LuaLimits *limits) {
+  if (!palette)
+    return;
+
+  char *config_home = get_config_home();
+  char *pattern = build_path(config_home, "cwal", "filters", "*.lua");
+  free(config_home);
+  if (!pattern)
+    return;
+
+  glob_t results;
+  if (glob(pattern, 0, NULL, &results) == 0) {
+    for (size_t i = 0; i < results.gl_pathc; i++) {
+      logging(INFO, "Applying filter: %s", results.gl_pathv[i]);
+      run_filter(results.gl_pathv[i], palette, limits);
+    }
+  }
+  globfree(&results);
+  free(pattern);
+}
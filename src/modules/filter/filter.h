@@ -0,0 +1,18 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include "core.h"
+
+// Runs every ~/.config/cwal/filters/*.lua script, in name order, on the
+// palette. Each script's Filter(palette) receives the palette as a mutable
+// FFI struct; a failing filter is skipped and its changes are discarded.
+void apply_palette_filters(Palette *palette, const LuaLimits *limits);
@@ -10,16 +10,26 @@
 
 #include "template.h"
 #include "utils/format_conversion.h"
+#include "utils/hash.h"
 #include "utils/path.h"
 #include "utils/utils.h"
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #define FMT_COUNT 9
 #define COLOR_STR_MAX 32
+#define BUNDLE_KEEP 16 // Rendered bundles kept for reuse
+#define PROGRAM_MAGIC "CWALTP2"
+#define PLACEHOLDER_MAX 128 // Longer brace contents are never placeholders
+#define MANIFEST_NAME ".manifest" // Dot files are never template outputs
 
 typedef struct {
   char fmt[FMT_COUNT][COLOR_STR_MAX];
@@ -38,6 +48,52 @@ typedef struct {
 static const char *fmt_names[] = {"hex",  "xhex", "hexa",  "strip", "rgb",
                                   "rgba", "red",  "green", "blue"};
 
+// What a placeholder expands to: each color in each format, then the rest
+enum {
+  SLOT_LITERAL = -1, // Template text copied as is
+  SLOT_WALLPAPER = PALETTE_MAX_SIZE * FMT_COUNT,
+  SLOT_MODE,
+  SLOT_ALPHA,
+  SLOT_ALPHA_HEX,
+  SLOT_ALPHA_PCT,
+  SLOT_ALPHA_INT,
+  SLOT_COUNT
+};
+
+// A span of the template text; for placeholders, the text is the braces kept
+// when the value is empty.
+typedef struct {
+  uint32_t offset;
+  uint32_t length;
+  int32_t slot;
+} Segment;
+
+// Edits within one second that keep the size still change the nanoseconds,
+// and editors that save by rename change the inode.
+typedef struct {
+  char magic[8];
+  int64_t mtime;
+  int64_t mtime_nsec;
+  int64_t size;
+  uint64_t inode;
+  uint32_t segment_count;
+  uint32_t text_length;
+} ProgramHeader;
+
+// A template compiled once into segments, followed in `body` by the text
+// they refer to. The compiled form is cached on disk, so rendering neither
+// reads nor parses the template again until it changes.
+typedef struct {
+  ProgramHeader header;
+  char *body;
+} Program;
+
+typedef struct {
+  Segment *items;
+  uint32_t count;
+  uint32_t capacity;
+} SegmentList;
+
 static ColorTable *build_color_table(const Palette *palette) {
   ColorTable *ct = malloc(sizeof(ColorTable));
   if (!ct)
@@ -62,26 +118,26 @@ static ColorTable *build_color_table(const Palette *palette) {
   return ct;
 }
 
-static const char *resolve_placeholder(const char *placeholder,
-                                       const ColorTable *ct) {
+// Returns the slot `placeholder` names, or SLOT_LITERAL if it names none
+static int placeholder_slot(const char *placeholder) {
   char key[64] = {0};
   int fmt_idx = 0; // default hex
   const char *dot = strrchr(placeholder, '.');
 
   if (strcmp(placeholder, "alpha") == 0) {
-    return ct->alpha_str;
+    return SLOT_ALPHA;
   }
   if (strncmp(placeholder, "alpha.", 6) == 0) {
     const char *fmt_str = placeholder + 6;
     if (strcmp(fmt_str, "hex") == 0)
-      return ct->alpha_hex;
+      return SLOT_ALPHA_HEX;
     if (strcmp(fmt_str, "pct") == 0 || strcmp(fmt_str, "percent") == 0)
-      return ct->alpha_pct;
+      return SLOT_ALPHA_PCT;
     if (strcmp(fmt_str, "dec") == 0 || strcmp(fmt_str, "float") == 0)
-      return ct->alpha_str;
+      return SLOT_ALPHA;
     if (strcmp(fmt_str, "int") == 0 || strcmp(fmt_str, "num") == 0)
-      return ct->alpha_int;
-    return NULL;
+      return SLOT_ALPHA_INT;
+    return SLOT_LITERAL;
   }
 
   if (dot && dot != placeholder) {
@@ -100,7 +156,7 @@ static const char *resolve_placeholder(const char *placeholder,
       }
     }
     if (!format_found)
-      return NULL;
+      return SLOT_LITERAL;
   } else {
     strncpy(key, placeholder, sizeof(key) - 1);
   }
@@ -109,124 +165,250 @@ static const char *resolve_placeholder(const char *placeholder,
     char *endptr;
     long index = strtol(key + 5, &endptr, 10);
     if (*endptr == '\0' && index >= 0 && index < PALETTE_MAX_SIZE)
-      return ct->colors[index].fmt[fmt_idx];
+      return (int)index * FMT_COUNT + fmt_idx;
   } else if (strcmp(key, "background") == 0) {
-    return ct->colors[0].fmt[fmt_idx];
+    return fmt_idx;
   } else if (strcmp(key, "foreground") == 0 || strcmp(key, "cursor") == 0) {
-    return ct->colors[PALETTE_MAX_SIZE - 1].fmt[fmt_idx];
-  } else if (strcmp(key, "wallpaper") == 0 && ct->wallpaper[0]) {
-    return ct->wallpaper;
+    return (PALETTE_MAX_SIZE - 1) * FMT_COUNT + fmt_idx;
+  } else if (strcmp(key, "wallpaper") == 0) {
+    return SLOT_WALLPAPER;
   } else if (strcmp(key, "mode") == 0) {
+    return SLOT_MODE;
+  }
+  return SLOT_LITERAL;
+}
+
+// NULL when the slot has no value, to keep the placeholder's own text
+static const char *slot_value(int slot, const ColorTable *ct) {
+  if (slot < SLOT_WALLPAPER)
+    return ct->colors[slot / FMT_COUNT].fmt[slot % FMT_COUNT];
+  switch (slot) {
+  case SLOT_WALLPAPER:
+    return ct->wallpaper[0] ? ct->wallpaper : NULL;
+  case SLOT_MODE:
     return ct->mode;
+  case SLOT_ALPHA:
+    return ct->alpha_str;
+  case SLOT_ALPHA_HEX:
+    return ct->alpha_hex;
+  case SLOT_ALPHA_PCT:
+    return ct->alpha_pct;
+  case SLOT_ALPHA_INT:
+    return ct->alpha_int;
   }
   return NULL;
 }
 
-static void replacement(FILE *in, FILE *out, const ColorTable *ct) {
-  fseek(in, 0, SEEK_END);
-  long size = ftell(in);
-  fseek(in, 0, SEEK_SET);
-  if (size <= 0)
-    return;
-
-  char *buf = malloc(size + 1);
-  if (!buf)
-    return;
-  size_t read_size = fread(buf, 1, size, in);
-  buf[read_size] = '\0';
-
-  size_t out_len = 0;
-  char *p = buf;
-  while (*p) {
-    char *brace = strchr(p, '{');
-    if (!brace) {
-      out_len += strlen(p);
-      break;
+// Adjacent literal spans are merged into one segment
+static int add_segment(SegmentList *list, int slot, size_t offset,
+                       size_t length) {
+  if (length == 0)
+    return 0;
+  if (slot == SLOT_LITERAL && list->count > 0) {
+    Segment *last = &list->items[list->count - 1];
+    if (last->slot == SLOT_LITERAL && last->offset + last->length == offset) {
+      last->length += (uint32_t)length;
+      return 0;
     }
-    out_len += (size_t)(brace - p);
+  }
+  if (list->count == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+    Segment *grown = realloc(list->items, capacity * sizeof(Segment));
+    if (!grown)
+      return -1;
+    list->items = grown;
+    list->capacity = capacity;
+  }
+  list->items[list->count++] =
+      (Segment){(uint32_t)offset, (uint32_t)length, (int32_t)slot};
+  return 0;
+}
 
-    char *close = strchr(brace + 1, '}');
-    if (!close) {
-      out_len += strlen(brace);
-      break;
-    }
+// A placeholder is the text between a '}' and the last '{' before it.
+// Anything else, including names that resolve to nothing, stays literal.
+static int compile_segments(const char *text, size_t len, SegmentList *list) {
+  size_t pos = 0;
+  while (pos < len) {
+    const char *brace = memchr(text + pos, '{', len - pos);
+    const char *close =
+        brace ? memchr(brace + 1, '}', len - (size_t)(brace + 1 - text))
+              : NULL;
+    if (!close)
+      return add_segment(list, SLOT_LITERAL, pos, len - pos);
 
-    char *inner_brace = strchr(brace + 1, '{');
-    while (inner_brace && inner_brace < close) {
-      out_len += (size_t)(inner_brace - brace);
-      brace = inner_brace;
-      inner_brace = strchr(brace + 1, '{');
+    const char *inner = memchr(brace + 1, '{', (size_t)(close - brace - 1));
+    while (inner) {
+      brace = inner;
+      inner = memchr(brace + 1, '{', (size_t)(close - brace - 1));
     }
 
-    char name[128] = {0};
-    size_t len = (size_t)(close - (brace + 1));
-    if (len < sizeof(name)) {
-      memcpy(name, brace + 1, len);
-      const char *res = resolve_placeholder(name, ct);
-      out_len += res ? strlen(res) : (len + 2);
-    } else {
-      out_len += (len + 2);
+    size_t start = (size_t)(brace - text);
+    size_t name_len = (size_t)(close - brace - 1);
+    int slot = SLOT_LITERAL;
+    if (name_len < PLACEHOLDER_MAX) {
+      char name[PLACEHOLDER_MAX];
+      memcpy(name, brace + 1, name_len);
+      name[name_len] = '\0';
+      slot = placeholder_slot(name);
     }
-    p = close + 1;
+    if (add_segment(list, SLOT_LITERAL, pos, start - pos) != 0 ||
+        add_segment(list, slot, start, name_len + 2) != 0)
+      return -1;
+    pos = start + name_len + 2;
   }
+  return 0;
+}
 
-  char *result = malloc(out_len + 1);
-  if (!result) {
-    free(buf);
-    return;
+static int compile_template(const char *template_path, Program *program) {
+  FILE *f = fopen(template_path, "rb");
+  if (!f)
+    return -1;
+  struct stat st;
+  char *text = NULL;
+  size_t len = 0;
+  if (fstat(fileno(f), &st) == 0 && st.st_size < UINT32_MAX &&
+      (text = malloc((size_t)st.st_size + 1)) != NULL) {
+    len = fread(text, 1, (size_t)st.st_size, f);
+    text[len] = '\0';
+    len = strlen(text); // Templates end at their first NUL byte
   }
-  size_t pos = 0;
-  p = buf;
-  while (*p) {
-    char *brace = strchr(p, '{');
-    if (!brace) {
-      strcpy(result + pos, p);
-      pos += strlen(p);
-      break;
-    }
-    size_t before = (size_t)(brace - p);
-    memcpy(result + pos, p, before);
-    pos += before;
-
-    char *close = strchr(brace + 1, '}');
-    if (!close) {
-      strcpy(result + pos, brace);
-      pos += strlen(brace);
-      break;
-    }
+  fclose(f);
+  if (!text)
+    return -1;
 
-    char *inner_brace = strchr(brace + 1, '{');
-    while (inner_brace && inner_brace < close) {
-      size_t skip = (size_t)(inner_brace - brace);
-      memcpy(result + pos, brace, skip);
-      pos += skip;
-      brace = inner_brace;
-      inner_brace = strchr(brace + 1, '{');
-    }
+  SegmentList list = {0};
+  int status = compile_segments(text, len, &list);
+  size_t segments_size = list.count * sizeof(Segment);
+  program->body = status == 0 ? malloc(segments_size + len + 1) : NULL;
+  if (program->body) {
+    memset(&program->header, 0, sizeof(program->header));
+    memcpy(program->header.magic, PROGRAM_MAGIC, sizeof(program->header.magic));
+    program->header.mtime = (int64_t)st.st_mtim.tv_sec;
+    program->header.mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    program->header.size = (int64_t)st.st_size;
+    program->header.inode = (uint64_t)st.st_ino;
+    program->header.segment_count = list.count;
+    program->header.text_length = (uint32_t)len;
+    if (segments_size)
+      memcpy(program->body, list.items, segments_size);
+    memcpy(program->body + segments_size, text, len);
+  } else {
+    status = -1;
+  }
+  free(list.items);
+  free(text);
+  return status;
+}
 
-    char name[128] = {0};
-    size_t len = (size_t)(close - (brace + 1));
-    if (len < sizeof(name)) {
-      memcpy(name, brace + 1, len);
-      const char *res = resolve_placeholder(name, ct);
-      if (res) {
-        size_t rlen = strlen(res);
-        memcpy(result + pos, res, rlen);
-        pos += rlen;
-      } else {
-        memcpy(result + pos, brace, len + 2);
-        pos += len + 2;
-      }
-    } else {
-      memcpy(result + pos, brace, len + 2);
-      pos += len + 2;
-    }
-    p = close + 1;
+static char *program_path(const char *programs, const char *template_path) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.tpl",
+           (unsigned long long)hash_string(template_path, 0));
+  return build_path(programs, name);
+}
+
+static int load_program(const char *path, const struct stat *st,
+                        Program *program) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return -1;
+
+  ProgramHeader *header = &program->header;
+  if (fread(header, sizeof(*header), 1, f) != 1 ||
+      memcmp(header->magic, PROGRAM_MAGIC, sizeof(header->magic)) != 0 ||
+      header->mtime != (int64_t)st->st_mtim.tv_sec ||
+      header->mtime_nsec != (int64_t)st->st_mtim.tv_nsec ||
+      header->size != (int64_t)st->st_size ||
+      header->inode != (uint64_t)st->st_ino) {
+    fclose(f);
+    return -1;
+  }
+
+  size_t body_size =
+      (size_t)header->segment_count * sizeof(Segment) + header->text_length;
+  program->body = malloc(body_size + 1);
+  bool ok = program->body &&
+            fread(program->body, 1, body_size, f) == body_size &&
+            fgetc(f) == EOF;
+  fclose(f);
+
+  // Every segment must stay within the text
+  const Segment *segments = (const Segment *)program->body;
+  for (uint32_t i = 0; ok && i < header->segment_count; i++) {
+    ok = segments[i].slot >= SLOT_LITERAL && segments[i].slot < SLOT_COUNT &&
+         (uint64_t)segments[i].offset + segments[i].length <=
+             header->text_length;
+  }
+  if (!ok) {
+    free(program->body);
+    return -1;
+  }
+  return 0;
+}
+
+// Written under a temporary name and renamed, so readers never see half
+static void store_program(const char *programs, const char *path,
+                          const Program *program) {
+  if (validate_or_create_dir(programs) != 0)
+    return;
+
+  char temp[PATH_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+  FILE *f = fopen(temp, "wb");
+  if (!f)
+    return;
+
+  size_t body_size = (size_t)program->header.segment_count * sizeof(Segment) +
+                     program->header.text_length;
+  bool ok = fwrite(&program->header, sizeof(program->header), 1, f) == 1 &&
+            fwrite(program->body, 1, body_size, f) == body_size;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(temp, path) != 0)
+    unlink(temp);
+}
+
+// Loads the compiled template from `programs` when it is current, and
+// compiles and stores it otherwise. `programs` may be NULL to skip the cache.
+static int load_template(const char *programs, const char *template_path,
+                         const struct stat *st, Program *program) {
+  char *cached = programs ? program_path(programs, template_path) : NULL;
+  int status = 0;
+  if (!cached || load_program(cached, st, program) != 0) {
+    status = compile_template(template_path, program);
+    if (status == 0 && cached)
+      store_program(programs, cached, program);
   }
-  result[pos] = '\0';
-  fwrite(result, 1, pos, out);
-  free(result);
-  free(buf);
+  free(cached);
+  return status;
+}
+
+static void render_program(const Program *program, const ColorTable *ct,
+                           FILE *out) {
+  const Segment *segments = (const Segment *)program->body;
+  const char *text =
+      program->body + program->header.segment_count * sizeof(Segment);
+  for (uint32_t i = 0; i < program->header.segment_count; i++) {
+    const char *value = segments[i].slot == SLOT_LITERAL
+                            ? NULL
+                            : slot_value(segments[i].slot, ct);
+    if (value)
+      fputs(value, out);
+    else
+      fwrite(text + segments[i].offset, 1, segments[i].length, out);
+  }
+}
+
+// Outputs are written under a temporary name and renamed into place, never
+// rewritten: once a bundle has been linked they share their inode with the
+// bundle's copy.
+static FILE *create_output(const char *path, char *temp, size_t size) {
+  snprintf(temp, size, "%s.%ld.tmp", path, (long)getpid());
+  return fopen(temp, "w");
+}
+
+static void finish_output(FILE *out, const char *temp, const char *path) {
+  if (fclose(out) != 0 || rename(temp, path) != 0)
+    unlink(temp);
 }
 
 static void generate_sequence(const char *out_path, const Palette *palette,
@@ -255,15 +437,16 @@ static void generate_sequence(const char *out_path, const Palette *palette,
     n += snprintf(seq + n, sizeof(seq) - n, "\033]12;#%02x%02x%02x\033\\",
                   fg->red, fg->green, fg->blue);
 
-  FILE *out = fopen(out_path, "w");
+  char temp[PATH_MAX];
+  FILE *out = create_output(out_path, temp, sizeof(temp));
   if (out) {
     fwrite(seq, 1, n, out);
-    fclose(out);
+    finish_output(out, temp, out_path);
   }
 }
 
 static void process_dir(const char *current_dir, const char *out_base,
-                        const ColorTable *ct) {
+                        const char *programs, const ColorTable *ct) {
   struct stat st;
   if (stat(current_dir, &st) == -1 || !S_ISDIR(st.st_mode))
     return;
@@ -277,22 +460,308 @@ static void process_dir(const char *current_dir, const char *out_base,
       continue;
     char *full_in = build_path(current_dir, entry->d_name);
     struct stat fst;
-    if (stat(full_in, &fst) == 0 && S_ISREG(fst.st_mode)) {
+    Program program;
+    if (stat(full_in, &fst) == 0 && S_ISREG(fst.st_mode) &&
+        load_template(programs, full_in, &fst, &program) == 0) {
       char *full_out = build_path(out_base, entry->d_name);
-      FILE *in = fopen(full_in, "r"), *out = fopen(full_out, "w");
-      if (in && out)
-        replacement(in, out, ct);
-      if (in)
-        fclose(in);
-      if (out)
-        fclose(out);
+      char temp[PATH_MAX];
+      FILE *out = full_out ? create_output(full_out, temp, sizeof(temp)) : NULL;
+      if (out) {
+        render_program(&program, ct, out);
+        finish_output(out, temp, full_out);
+      }
       free(full_out);
+      free(program.body);
     }
     free(full_in);
   }
   closedir(dir);
 }
 
+// Template directories, lowest precedence first, NULL-terminated
+static char **template_dirs(void) {
+  char **system_dirs = get_data_dirs();
+  int count = 0;
+  while (system_dirs && system_dirs[count])
+    count++;
+
+  char **dirs = calloc((size_t)count + 3, sizeof(char *));
+  int n = 0;
+  for (int i = 0; i < count; i++) {
+    if (dirs)
+      dirs[n++] = build_path(system_dirs[i], "cwal", "templates");
+    free(system_dirs[i]);
+  }
+  free(system_dirs);
+  if (!dirs)
+    return NULL;
+
+  char *data_home = get_data_home(), *config_home = get_config_home();
+  dirs[n++] = build_path(data_home, "cwal", "templates");
+  dirs[n++] = build_path(config_home, "cwal", "templates");
+  free(data_home);
+  free(config_home);
+
+  // A directory that failed to resolve is skipped
+  int kept = 0;
+  for (int i = 0; i < n; i++) {
+    if (dirs[i])
+      dirs[kept++] = dirs[i];
+  }
+  dirs[kept] = NULL;
+  return dirs;
+}
+
+static void free_template_dirs(char **dirs) {
+  for (int i = 0; dirs && dirs[i]; i++)
+    free(dirs[i]);
+  free(dirs);
+}
+
+// Identifies a rendering by everything it depends on: the palette fields
+// templates use, the cursor option, and each template's name, size, mtime
+// and inode. Files within a directory are summed, so readdir order does not
+// matter.
+static uint64_t bundle_key(const Palette *palette, bool skip_cursor,
+                           char **dirs) {
+  int32_t options[2] = {(int32_t)palette->mode, skip_cursor};
+  uint64_t key = hash_bytes(palette->colors, sizeof(palette->colors), 0);
+  key = hash_bytes(&palette->alpha, sizeof(palette->alpha), key);
+  key = hash_bytes(options, sizeof(options), key);
+  key = hash_string(palette->wallpaper ? palette->wallpaper : "", key);
+
+  for (int i = 0; dirs[i]; i++) {
+    uint64_t files = 0;
+    DIR *dir = opendir(dirs[i]);
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+      if (entry->d_name[0] == '.')
+        continue;
+      struct stat st;
+      if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0 ||
+          !S_ISREG(st.st_mode))
+        continue;
+      uint64_t signature[4] = {(uint64_t)st.st_size,
+                               (uint64_t)st.st_mtim.tv_sec,
+                               (uint64_t)st.st_mtim.tv_nsec,
+                               (uint64_t)st.st_ino};
+      files += hash_bytes(signature, sizeof(signature),
+                          hash_string(entry->d_name, 0));
+    }
+    if (dir)
+      closedir(dir);
+    key = hash_bytes(&files, sizeof(files), hash_string(dirs[i], key));
+  }
+  return key;
+}
+
+static void remove_bundle(const char *bundle) {
+  DIR *dir = opendir(bundle);
+  struct dirent *entry;
+  while (dir && (entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+      unlinkat(dirfd(dir), entry->d_name, 0);
+  }
+  if (dir)
+    closedir(dir);
+  rmdir(bundle);
+}
+
+typedef struct {
+  char *name;
+  time_t mtime;
+} BundleEntry;
+
+static int compare_bundles(const void *a, const void *b) {
+  time_t x = ((const BundleEntry *)a)->mtime;
+  time_t y = ((const BundleEntry *)b)->mtime;
+  return (x > y) - (x < y);
+}
+
+// Keeps the BUNDLE_KEEP most recently used bundles
+static void prune_bundles(const char *bundles) {
+  DIR *dir = opendir(bundles);
+  if (!dir)
+    return;
+  BundleEntry *entries = NULL;
+  int count = 0, capacity = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    struct stat st;
+    if (entry->d_name[0] == '.' ||
+        fstatat(dirfd(dir), entry->d_name, &st, 0) != 0)
+      continue;
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 32;
+      BundleEntry *grown = realloc(entries, capacity * sizeof(BundleEntry));
+      if (!grown)
+        break;
+      entries = grown;
+    }
+    entries[count].name = strdup(entry->d_name);
+    entries[count].mtime = st.st_mtime;
+    if (entries[count].name)
+      count++;
+  }
+  closedir(dir);
+
+  qsort(entries, count, sizeof(BundleEntry), compare_bundles);
+  for (int i = 0; i < count; i++) {
+    if (i < count - BUNDLE_KEEP) {
+      char *path = build_path(bundles, entries[i].name);
+      if (path)
+        remove_bundle(path);
+      free(path);
+    }
+    free(entries[i].name);
+  }
+  free(entries);
+}
+
+// Records each rendered file's size and mtime. The outputs share inodes with
+// the bundle, so a consumer rewriting an output in place changes the bundle
+// too; verify_bundle notices and the bundle is rendered again.
+static void write_manifest(const char *bundle) {
+  DIR *dir = opendir(bundle);
+  char *path = build_path(bundle, MANIFEST_NAME);
+  FILE *manifest = dir && path ? fopen(path, "w") : NULL;
+  struct dirent *entry;
+  while (manifest && (entry = readdir(dir)) != NULL) {
+    struct stat st;
+    if (entry->d_name[0] != '.' &&
+        fstatat(dirfd(dir), entry->d_name, &st, 0) == 0)
+      fprintf(manifest, "%lld %lld %ld %s\n", (long long)st.st_size,
+              (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec,
+              entry->d_name);
+  }
+  if (manifest)
+    fclose(manifest);
+  if (dir)
+    closedir(dir);
+  free(path);
+}
+
+static bool verify_bundle(const char *bundle) {
+  char *path = build_path(bundle, MANIFEST_NAME);
+  FILE *manifest = path ? fopen(path, "r") : NULL;
+  free(path);
+  if (!manifest)
+    return false;
+
+  bool intact = true;
+  char line[PATH_MAX + 64];
+  while (intact && fgets(line, sizeof(line), manifest)) {
+    long long size, sec;
+    long nsec;
+    int name_at = 0;
+    line[strcspn(line, "\n")] = '\0';
+    char *file = NULL;
+    struct stat st;
+    intact = sscanf(line, "%lld %lld %ld %n", &size, &sec, &nsec,
+                    &name_at) == 3 &&
+             (file = build_path(bundle, line + name_at)) != NULL &&
+             stat(file, &st) == 0 && (long long)st.st_size == size &&
+             (long long)st.st_mtim.tv_sec == sec &&
+             (long)st.st_mtim.tv_nsec == nsec;
+    free(file);
+  }
+  fclose(manifest);
+  return intact;
+}
+
+// Points the output files at a bundle's. Each is hard-linked under a
+// temporary name and renamed over the old file, so nothing ever sees it
+// half-written and the bundle's copy is never modified.
+static int link_bundle(const char *bundle, const char *out_base) {
+  DIR *dir = opendir(bundle);
+  if (!dir)
+    return -1;
+  int status = 0;
+  struct dirent *entry;
+  while (status == 0 && (entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.')
+      continue;
+    char *src = build_path(bundle, entry->d_name);
+    char *dst = build_path(out_base, entry->d_name);
+    char temp[PATH_MAX];
+    status = src && dst ? 0 : -1;
+    if (status == 0) {
+      snprintf(temp, sizeof(temp), "%s.%ld.tmp", dst, (long)getpid());
+      status = link(src, temp);
+    }
+    if (status == 0) {
+      status = rename(temp, dst);
+      // rename() keeps both names when dst already is this bundle's file
+      unlink(temp);
+    }
+    free(src);
+    free(dst);
+  }
+  closedir(dir);
+  return status;
+}
+
+static void render_templates(char **dirs, const char *out_base,
+                             const char *programs, const ColorTable *ct,
+                             const Palette *palette, bool skip_cursor) {
+  for (int i = 0; dirs[i]; i++)
+    process_dir(dirs[i], out_base, programs, ct);
+
+  char *seq_path = build_path(out_base, "sequences");
+  generate_sequence(seq_path, palette, skip_cursor);
+  free(seq_path);
+}
+
+// Renders into bundles/<key> and links the outputs from there. A palette
+// and template set seen before reuses its bundle without rendering, which
+// makes restores and switching back to a theme a handful of syscalls.
+static int render_bundle(char **dirs, const char *out_base,
+                         const char *programs, const Palette *palette,
+                         bool skip_cursor) {
+  char key[17];
+  snprintf(key, sizeof(key), "%016" PRIx64,
+           bundle_key(palette, skip_cursor, dirs));
+  char *bundles = build_path(out_base, "bundles");
+  char *bundle = build_path(bundles, key);
+  if (!bundle) {
+    free(bundles);
+    return -1;
+  }
+
+  struct stat st;
+  if (stat(bundle, &st) == 0) {
+    if (!verify_bundle(bundle)) {
+      logging(WARN, "Rendered templates were modified, rendering again: %s",
+              bundle);
+      remove_bundle(bundle);
+    } else if (link_bundle(bundle, out_base) == 0) {
+      logging(INFO, "Reusing rendered templates: %s", bundle);
+      utimensat(AT_FDCWD, bundle, NULL, 0); // Most recently used
+      free(bundle);
+      free(bundles);
+      return 0;
+    }
+  }
+
+  int status = -1;
+  ColorTable *ct = build_color_table(palette);
+  char temp[PATH_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", bundle, (long)getpid());
+  if (ct && validate_or_create_dir(bundles) == 0 && mkdir(temp, 0700) == 0) {
+    render_templates(dirs, temp, programs, ct, palette, skip_cursor);
+    write_manifest(temp);
+    // Another process may have rendered the same bundle meanwhile
+    if (rename(temp, bundle) != 0)
+      remove_bundle(temp);
+    status = link_bundle(bundle, out_base);
+    prune_bundles(bundles);
+  }
+  free(ct);
+  free(bundle);
+  free(bundles);
+  return status;
+}
+
 int process_template(const char *output_dir, const Palette *palette,
                      bool skip_cursor) {
   char *out_base = expand_home(output_dir);
@@ -305,37 +774,26 @@ int process_template(const char *output_dir, const Palette *palette,
     free(out_base);
     return -1;
   }
-  ColorTable *ct = build_color_table(palette);
-  if (!ct) {
+  char **dirs = template_dirs();
+  if (!dirs) {
     free(out_base);
     return -1;
   }
 
-  char **system_dirs = get_data_dirs();
-  if (system_dirs) {
-    for (int i = 0; system_dirs[i]; i++) {
-      char *p = build_path(system_dirs[i], "cwal", "templates");
-      process_dir(p, out_base, ct);
-      free(p);
-      free(system_dirs[i]);
+  // Without bundles (no hard links, say), render in place as before
+  char *programs = build_path(out_base, "compiled");
+  int status = render_bundle(dirs, out_base, programs, palette, skip_cursor);
+  if (status != 0) {
+    ColorTable *ct = build_color_table(palette);
+    if (ct) {
+      render_templates(dirs, out_base, programs, ct, palette, skip_cursor);
+      status = 0;
     }
-    free(system_dirs);
+    free(ct);
   }
 
-  char *data_home = get_data_home(), *config_home = get_config_home();
-  char *d1 = build_path(data_home, "cwal", "templates"),
-       *d2 = build_path(config_home, "cwal", "templates");
-  process_dir(d1, out_base, ct);
-  process_dir(d2, out_base, ct);
-
-  char *seq_path = build_path(out_base, "sequences");
-  generate_sequence(seq_path, palette, skip_cursor);
-  free(seq_path);
-  free(data_home);
-  free(config_home);
-  free(d1);
-  free(d2);
-  free(ct);
+  free(programs);
+  free_template_dirs(dirs);
   free(out_base);
-  return 0;
+  return status;
 }
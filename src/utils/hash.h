@@ -0,0 +1,18 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// XXH64. Used for cache keys, so the output must stay stable across releases.
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+uint64_t hash_string(const char *str, uint64_t seed);
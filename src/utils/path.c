@@ -172,7 +172,15 @@ int validate_or_create_dir(const char *dir_in) {
   return 0;
 }
 
-char *get_random_image_path(const char *directory_in) {
+void free_image_files(char **image_files, int count) {
+  for (int i = 0; i < count; i++) {
+    free(image_files[i]);
+  }
+  free(image_files);
+}
+
+char **list_image_files(const char *directory_in, int *count_out) {
+  *count_out = 0;
   char *directory = expand_home(directory_in);
   if (!directory) {
     logging(ERROR, "Failed to expand home directory for: %s", directory_in);
@@ -183,7 +191,6 @@ char *get_random_image_path(const char *directory_in) {
   struct dirent *dir;
   char **image_files = NULL;
   int count = 0;
-  char *random_image_path = NULL;
 
   d = opendir(directory);
   if (!d) {
@@ -197,33 +204,20 @@ char *get_random_image_path(const char *directory_in) {
       continue;
     }
 
-    char *name = strdup(dir->d_name);
-    if (!name) {
-      logging(ERROR, "Memory allocation failed for file name.\n");
-      closedir(d);
-      free(directory);
-      for (int i = 0; i < count; i++) {
-        free(image_files[i]);
-      }
-      free(image_files);
-      return NULL;
-    }
-
-    char **resized = realloc(image_files, sizeof(char *) * (count + 1));
+    char *path = build_path(directory, dir->d_name);
+    char **resized =
+        path ? realloc(image_files, sizeof(char *) * (count + 1)) : NULL;
     if (!resized) {
       logging(ERROR, "Memory allocation failed for image files.\n");
-      free(name);
+      free(path);
       closedir(d);
       free(directory);
-      for (int i = 0; i < count; i++) {
-        free(image_files[i]);
-      }
-      free(image_files);
+      free_image_files(image_files, count);
       return NULL;
     }
 
     image_files = resized;
-    image_files[count] = name;
+    image_files[count] = path;
     count++;
   }
   closedir(d);
@@ -234,21 +228,26 @@ char *get_random_image_path(const char *directory_in) {
     return NULL;
   }
 
+  free(directory);
+  *count_out = count;
+  return image_files;
+}
+
+char *get_random_image_path(const char *directory_in) {
+  int count;
+  char **image_files = list_image_files(directory_in, &count);
+  if (!image_files) {
+    return NULL;
+  }
+
   unsigned int seed = time(NULL);
   int random_index = rand_r(&seed) % count;
-  char *selected_file = image_files[random_index];
-
-  random_image_path = build_path(directory, selected_file);
+  char *random_image_path = strdup(image_files[random_index]);
   if (!random_image_path) {
     logging(ERROR, "Memory allocation failed for random image path.");
   }
 
-  for (int i = 0; i < count; i++) {
-    free(image_files[i]);
-  }
-  free(image_files);
-  free(directory);
-
+  free_image_files(image_files, count);
   return random_image_path;
 }
 
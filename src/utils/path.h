@@ -16,6 +16,10 @@ char *get_cache_home(void);
 char *get_data_home(void);
 char **get_data_dirs(void);
 int validate_or_create_dir(const char *dir_in);
+// Full paths of the supported images directly inside `directory`, or NULL
+// when there are none. Freed with free_image_files.
+char **list_image_files(const char *directory, int *count);
+void free_image_files(char **image_files, int count);
 char *get_random_image_path(const char *directory);
 char *build_path_internal(const char *first, ...);
 #define build_path(...) build_path_internal(__VA_ARGS__, NULL)
@@ -0,0 +1,154 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Checks the batch conversion kernels selected by CWAL_SIMD against the
+// per-color functions over every 24-bit color, and reports both throughputs.
+// Above the scalar level, a kernel slower than the per-color loop fails.
+
+#include "color/color_batch.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PIXELS (1 << 24)
+
+// Forward kernels reproduce the per-color results exactly, except where
+// cbrtf is replaced by a Newton iteration.
+#define LAB_TOLERANCE 1e-3f
+#define OKLAB_TOLERANCE 1e-5f
+
+static int failures = 0;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Color pixel_at(const uint8_t *pixels, size_t i) {
+  return (Color){pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]};
+}
+
+static bool same_color(Color a, Color b) {
+  return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+static void report(const char *name, size_t mismatches, double batch,
+                   double scalar) {
+  printf("%-12s %8.1f Mpx/s batch %8.1f Mpx/s scalar %zu mismatches\n", name,
+         PIXELS / batch / 1e6, PIXELS / scalar / 1e6, mismatches);
+  if (mismatches) {
+    fprintf(stderr, "FAIL: %s differs from the per-color function\n", name);
+    failures++;
+  }
+  if (color_batch_level() != SIMD_SCALAR && batch > scalar) {
+    fprintf(stderr, "FAIL: %s is slower than the per-color function\n", name);
+    failures++;
+  }
+}
+
+#define CHECK_FORWARD(name, type, batch_fn, scalar_fn, differs)                \
+  do {                                                                         \
+    double start = now();                                                      \
+    batch_fn(pixels, 4, batch_out, PIXELS);                                    \
+    double batch_time = now() - start;                                         \
+    start = now();                                                             \
+    for (size_t i = 0; i < PIXELS; i++)                                        \
+      ((type *)scalar_out)[i] = scalar_fn(pixel_at(pixels, i));                \
+    double scalar_time = now() - start;                                        \
+    size_t bad = 0;                                                            \
+    for (size_t i = 0; i < PIXELS; i++) {                                      \
+      type a = ((type *)batch_out)[i], b = ((type *)scalar_out)[i];            \
+      bad += (differs) ? 1 : 0;                                                \
+    }                                                                          \
+    report(name, bad, batch_time, scalar_time);                                \
+  } while (0)
+
+#define CHECK_INVERSE(name, type, batch_fn, scalar_fn)                         \
+  do {                                                                         \
+    const type *in = (const type *)scalar_out;                                 \
+    double start = now();                                                      \
+    batch_fn(in, colors, PIXELS);                                              \
+    double batch_time = now() - start;                                         \
+    start = now();                                                             \
+    for (size_t i = 0; i < PIXELS; i++)                                        \
+      expected[i] = scalar_fn(in[i]);                                          \
+    double scalar_time = now() - start;                                        \
+    size_t bad = 0;                                                            \
+    for (size_t i = 0; i < PIXELS; i++)                                        \
+      bad += same_color(colors[i], expected[i]) ? 0 : 1;                       \
+    report(name, bad, batch_time, scalar_time);                                \
+  } while (0)
+
+int main(void) {
+  uint8_t *pixels = malloc((size_t)PIXELS * 4);
+  void *batch_out = malloc((size_t)PIXELS * sizeof(Lab));
+  void *scalar_out = malloc((size_t)PIXELS * sizeof(Lab));
+  Color *colors = malloc((size_t)PIXELS * sizeof(Color));
+  Color *expected = malloc((size_t)PIXELS * sizeof(Color));
+  if (!pixels || !batch_out || !scalar_out || !colors || !expected) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  // RGBA like a RawImage, covering the whole sRGB cube once
+  for (size_t i = 0; i < PIXELS; i++) {
+    pixels[i * 4] = i & 255;
+    pixels[i * 4 + 1] = (i >> 8) & 255;
+    pixels[i * 4 + 2] = (i >> 16) & 255;
+    pixels[i * 4 + 3] = 255;
+  }
+
+  printf("kernels: %s\n", color_batch_level_name(color_batch_level()));
+
+  // Each inverse kernel runs on the per-color forward results, so it sees
+  // every value the conversions produce in practice.
+  CHECK_FORWARD("rgb_to_hsl", HSL, rgb_to_hsl_batch, rgb_to_hsl,
+                memcmp(&a, &b, sizeof(a)) != 0);
+  CHECK_INVERSE("hsl_to_rgb", HSL, hsl_to_rgb_batch, hls_to_rgb);
+  CHECK_FORWARD("rgb_to_hsv", HSV, rgb_to_hsv_batch, rgb_to_hsv,
+                memcmp(&a, &b, sizeof(a)) != 0);
+  CHECK_INVERSE("hsv_to_rgb", HSV, hsv_to_rgb_batch, hsv_to_rgb);
+  CHECK_FORWARD("rgb_to_lab", Lab, rgb_to_lab_batch, rgb_to_lab,
+                fabsf(a.l - b.l) > LAB_TOLERANCE ||
+                    fabsf(a.a - b.a) > LAB_TOLERANCE ||
+                    fabsf(a.b - b.b) > LAB_TOLERANCE);
+  CHECK_INVERSE("lab_to_rgb", Lab, lab_to_rgb_batch, lab_to_rgb);
+  CHECK_FORWARD("rgb_to_oklab", OKLab, rgb_to_oklab_batch, rgb_to_oklab,
+                fabsf(a.l - b.l) > OKLAB_TOLERANCE ||
+                    fabsf(a.a - b.a) > OKLAB_TOLERANCE ||
+                    fabsf(a.b - b.b) > OKLAB_TOLERANCE);
+  CHECK_INVERSE("oklab_to_rgb", OKLab, oklab_to_rgb_batch, oklab_to_rgb);
+
+  // A RawImage row goes through the same kernels with the RGBA stride
+  RawImage image = {pixels, 4096, PIXELS / 4096, 4};
+  size_t bad = 0;
+  for (int row = 0; row < image.height; row += 97) {
+    HSL *out = batch_out;
+    image_row_to_hsl(&image, row, out);
+    for (int x = 0; x < image.width; x++) {
+      HSL ref = rgb_to_hsl(pixel_at(pixels, (size_t)row * image.width + x));
+      bad += memcmp(&out[x], &ref, sizeof(ref)) != 0;
+    }
+  }
+  if (bad) {
+    fprintf(stderr, "FAIL: image_row_to_hsl has %zu mismatches\n", bad);
+    failures++;
+  }
+
+  free(pixels);
+  free(batch_out);
+  free(scalar_out);
+  free(colors);
+  free(expected);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Checks the table-driven w3_luminance against the powf formula it replaced,
+// and the fixed-point shade operations against the float versions: every
+// channel must be within 1 of the float result, amounts out of range included.
+
+#include "color/color_conversion.h"
+#include "color/color_operation.h"
+#include "utils/utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_ERROR 1
+
+static float reference_luminance(Color clr) {
+  float c[3] = {clr.red / 255.0f, clr.green / 255.0f, clr.blue / 255.0f};
+  for (int i = 0; i < 3; i++)
+    c[i] = (c[i] <= 0.04045f) ? c[i] / 12.92f
+                              : powf((c[i] + 0.055f) / 1.055f, 2.4f);
+  return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+static Color reference_darken(Color clr, float amount) {
+  amount = clamp_value(amount);
+  return (Color){(uint8_t)(clr.red * (1.0f - amount)),
+                 (uint8_t)(clr.green * (1.0f - amount)),
+                 (uint8_t)(clr.blue * (1.0f - amount))};
+}
+
+static Color reference_lighten(Color clr, float amount) {
+  amount = clamp_value(amount);
+  return (Color){(uint8_t)(clr.red + (255 - clr.red) * amount),
+                 (uint8_t)(clr.green + (255 - clr.green) * amount),
+                 (uint8_t)(clr.blue + (255 - clr.blue) * amount)};
+}
+
+static Color reference_saturate(Color clr, float amount) {
+  HSL hsl = rgb_to_hsl(clr);
+  hsl.s = clamp_value(hsl.s + amount);
+  return hls_to_rgb(hsl);
+}
+
+static int distance(Color a, Color b) {
+  int d = abs(a.red - b.red);
+  if (abs(a.green - b.green) > d)
+    d = abs(a.green - b.green);
+  if (abs(a.blue - b.blue) > d)
+    d = abs(a.blue - b.blue);
+  return d;
+}
+
+typedef struct {
+  const char *name;
+  Color (*fixed)(Color, float);
+  Color (*reference)(Color, float);
+  int worst;
+  long exact;
+} Operation;
+
+int main(void) {
+  int failures = 0;
+
+  long luminance_mismatches = 0;
+  for (int i = 0; i < 1 << 24; i++) {
+    Color clr = {i & 255, (i >> 8) & 255, (i >> 16) & 255};
+    if (w3_luminance(clr) != reference_luminance(clr))
+      luminance_mismatches++;
+  }
+  printf("w3_luminance: %ld of 16777216 colors differ from powf\n",
+         luminance_mismatches);
+  failures += luminance_mismatches != 0;
+
+  Operation ops[] = {
+      {"darken", darken_color, reference_darken, 0, 0},
+      {"lighten", lighten_color, reference_lighten, 0, 0},
+      {"saturate", saturate_color, reference_saturate, 0, 0},
+  };
+  long checked = 0;
+  for (int r = 0; r < 256; r += 3) {
+    for (int g = 0; g < 256; g += 5) {
+      for (int b = 0; b < 256; b++) {
+        Color clr = {r, g, b};
+        for (int step = -30; step <= 30; step += 2) {
+          float amount = step / 20.0f;
+          for (int k = 0; k < 3; k++) {
+            Color fixed = ops[k].fixed(clr, amount);
+            int d = distance(fixed, ops[k].reference(clr, amount));
+            ops[k].exact += d == 0;
+            if (d > MAX_ERROR && ops[k].worst <= MAX_ERROR)
+              fprintf(stderr, "%s(%d, %d, %d; %g) is off by %d\n",
+                      ops[k].name, r, g, b, amount, d);
+            if (d > ops[k].worst)
+              ops[k].worst = d;
+          }
+          checked++;
+        }
+      }
+    }
+  }
+  for (int k = 0; k < 3; k++) {
+    printf("%-8s max error %d, exact on %ld of %ld\n", ops[k].name,
+           ops[k].worst, ops[k].exact, checked);
+    failures += ops[k].worst > MAX_ERROR;
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Runs process_colors_batch and process_colors on the same random palettes,
+// covering every mode, cols16 mode and engine, and requires identical colors.
+// Reports palettes per second for both, and fails when a vector level's
+// batch path is the slower one. process_color_variants, which every cache
+// miss goes through, is held to the same standard.
+
+#include "color/color_batch.h"
+#include "color/colors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PALETTES 200000
+#define RUNS 3 // Best of, against timing noise
+#define VARIANT_RAWS 50000
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Color random_color(int mask) {
+  return (Color){rand() & mask, rand() & mask, rand() & mask};
+}
+
+static void random_palette(Palette *palette, int index) {
+  static const float saturations[] = {0.0f, 0.1f, -0.2f, 0.35f};
+  static const float contrasts[] = {0.0f, 1.0f, 3.0f, 4.5f, 7.0f};
+
+  memset(palette, 0, sizeof(*palette));
+  for (int i = 0; i < PALETTE_MAX_SIZE; i++)
+    palette->colors[i] = random_color(255);
+  // Dark and gray wallpapers take the boost and gray branches
+  if (index % 7 == 0) {
+    for (int i = 0; i < 8; i++)
+      palette->colors[i] = random_color(31);
+  }
+  if (index % 11 == 0) {
+    for (int i = 0; i < 8; i++) {
+      uint8_t gray = rand() & 255;
+      palette->colors[i] = (Color){gray, gray, gray};
+    }
+  }
+  palette->mode = (rand() & 1) ? LIGHT : DARK;
+  palette->cols16_mode = (rand() & 1) ? LIGHTEN : DARKEN;
+  palette->engine = (index % 53 == 0) ? ENGINE_OKLCH : ENGINE_HSV;
+  palette->saturation = saturations[rand() % 4];
+  palette->contrast = contrasts[rand() % 5];
+  palette->alpha = 1.0f;
+}
+
+// process_color_variants against each variant through process_colors.
+// Returns the failures.
+static int check_variants(const Palette *raws) {
+  static const COLOR_MODE modes[] = {DARK, DARK, LIGHT, LIGHT};
+  static const SHADE_MODE shades[] = {DARKEN, LIGHTEN, DARKEN, LIGHTEN};
+  static Palette variants[VARIANT_RAWS][PALETTE_VARIANTS];
+  static Palette expected[VARIANT_RAWS][PALETTE_VARIANTS];
+
+  double variants_time = 0.0, single_time = 0.0;
+  for (int run = 0; run < RUNS; run++) {
+    double start = now();
+    for (int i = 0; i < VARIANT_RAWS; i++)
+      process_color_variants(&raws[i], variants[i]);
+    double elapsed = now() - start;
+    if (run == 0 || elapsed < variants_time)
+      variants_time = elapsed;
+
+    start = now();
+    for (int i = 0; i < VARIANT_RAWS; i++) {
+      for (int v = 0; v < PALETTE_VARIANTS; v++) {
+        expected[i][v] = raws[i];
+        expected[i][v].mode = modes[v];
+        expected[i][v].cols16_mode = shades[v];
+        process_colors(&expected[i][v]);
+      }
+    }
+    elapsed = now() - start;
+    if (run == 0 || elapsed < single_time)
+      single_time = elapsed;
+  }
+
+  int mismatches = 0;
+  for (int i = 0; i < VARIANT_RAWS; i++) {
+    for (int v = 0; v < PALETTE_VARIANTS; v++)
+      mismatches += memcmp(variants[i][v].colors, expected[i][v].colors,
+                           sizeof(expected[i][v].colors)) != 0;
+  }
+  printf("%d raw palettes: %.0f/s process_color_variants, %.0f/s "
+         "process_colors x%d (x%.2f), %d mismatches\n",
+         VARIANT_RAWS, VARIANT_RAWS / variants_time,
+         VARIANT_RAWS / single_time, PALETTE_VARIANTS,
+         single_time / variants_time, mismatches);
+
+  int failures = mismatches ? 1 : 0;
+  if (color_batch_level() != SIMD_SCALAR && variants_time > single_time) {
+    fprintf(stderr, "FAIL: process_color_variants is slower than "
+                    "process_colors\n");
+    failures++;
+  }
+  return failures;
+}
+
+int main(void) {
+  Palette *input = malloc(PALETTES * sizeof(Palette));
+  Palette *expected = malloc(PALETTES * sizeof(Palette));
+  PaletteBatch batch;
+  if (!input || !expected || palette_batch_init(&batch, PALETTES) != 0) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  srand(7);
+  for (int i = 0; i < PALETTES; i++)
+    random_palette(&input[i], i);
+
+  double single_time = 0.0, batch_time = 0.0;
+  for (int run = 0; run < RUNS; run++) {
+    memcpy(expected, input, PALETTES * sizeof(Palette));
+    double start = now();
+    for (int i = 0; i < PALETTES; i++)
+      process_colors(&expected[i]);
+    double elapsed = now() - start;
+    if (run == 0 || elapsed < single_time)
+      single_time = elapsed;
+
+    batch.count = 0;
+    for (int i = 0; i < PALETTES; i++)
+      palette_batch_push(&batch, &input[i]);
+    start = now();
+    process_colors_batch(&batch);
+    elapsed = now() - start;
+    if (run == 0 || elapsed < batch_time)
+      batch_time = elapsed;
+  }
+
+  int mismatches = 0;
+  for (int i = 0; i < PALETTES; i++) {
+    Palette result;
+    palette_batch_get(&batch, i, &result);
+    if (memcmp(result.colors, expected[i].colors, sizeof(result.colors)) == 0)
+      continue;
+    if (mismatches++ < 5)
+      fprintf(stderr, "palette %d: mode %d cols16 %d saturation %g "
+                      "contrast %g differs\n",
+              i, expected[i].mode, expected[i].cols16_mode,
+              expected[i].saturation, expected[i].contrast);
+  }
+
+  SimdLevel level = color_batch_level();
+  printf("kernels: %s\n", color_batch_level_name(level));
+  printf("%d palettes: %.0f/s process_colors, %.0f/s batch (x%.2f), "
+         "%d mismatches\n",
+         PALETTES, PALETTES / single_time, PALETTES / batch_time,
+         single_time / batch_time, mismatches);
+
+  // The scalar level is process_colors itself
+  bool slower = level != SIMD_SCALAR && batch_time > single_time;
+  if (slower)
+    fprintf(stderr, "FAIL: the %s batch path is slower than process_colors\n",
+            color_batch_level_name(level));
+
+  int variant_failures = check_variants(input);
+
+  palette_batch_free(&batch);
+  free(expected);
+  free(input);
+  return mismatches || slower || variant_failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Runs misbehaving backend scripts under the Lua limits: an endless loop, an
+// allocation bomb, a loop over the instruction budget, and an image table
+// kept in a global. Each must be stopped with the expected limit or error,
+// and a well-behaved script run right after must still produce a palette.
+
+#include "backends/lua_backend.h"
+#include "backends/lua_vm.h"
+#include <lua.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define IMAGE_PATH "/nonexistent/wallpaper.png"
+
+static const char *well_behaved = "function Main()\n"
+                                  "  local colors = {}\n"
+                                  "  for i = 1, 16 do\n"
+                                  "    colors[i] = {i * 15, i * 15, i * 15}\n"
+                                  "  end\n"
+                                  "  return colors\n"
+                                  "end\n";
+
+// Keeps the image table on the first run and reads it on the second
+static const char *kept_image = "function Main(image_path, image)\n"
+                                "  if Kept then return {Kept.width} end\n"
+                                "  Kept = image\n"
+                                "  local colors = {}\n"
+                                "  for i = 1, 16 do\n"
+                                "    colors[i] = {0, 0, 0}\n"
+                                "  end\n"
+                                "  return colors\n"
+                                "end\n";
+
+static char dir[] = "/tmp/cwal-lua-XXXXXX";
+
+static const char *write_script(const char *name, const char *source) {
+  static char path[256];
+  snprintf(path, sizeof(path), "%s/%s.lua", dir, name);
+  FILE *f = fopen(path, "w");
+  if (!f || fputs(source, f) == EOF) {
+    perror(path);
+    exit(1);
+  }
+  fclose(f);
+  return path;
+}
+
+// Calls the script's Main under `limits` and returns the limit the run hit.
+static const char *run_limited(const char *path, const LuaLimits *limits) {
+  lua_State *L = lua_vm_state();
+  int top = lua_gettop(L);
+  lua_vm_begin_run(limits);
+  if (lua_vm_push_script(path) == 0) {
+    lua_getfield(L, -1, "Main");
+    lua_pushstring(L, IMAGE_PATH);
+    if (lua_pcall(L, 1, 0, 0) != LUA_OK)
+      fprintf(stderr, "  %s\n", lua_tostring(L, -1));
+  }
+  const char *exceeded = lua_vm_end_run();
+  // A hit closes the state along with the stack
+  if (!exceeded)
+    lua_settop(L, top);
+  return exceeded;
+}
+
+static int generate(const char *path, const LuaLimits *limits) {
+  RawImage *image = NULL;
+  Palette palette = {0};
+  int status = lua_generate_palette(path, IMAGE_PATH, &image, &palette,
+                                    limits);
+  image_free(image);
+  return status;
+}
+
+static int check_limit(const char *name, const char *source,
+                       const LuaLimits *limits, const char *expected) {
+  const char *exceeded = run_limited(write_script(name, source), limits);
+  int next = generate(write_script("well_behaved", well_behaved), limits);
+  printf("%-12s stopped by %s, next run %s\n", name,
+         exceeded ? exceeded : "nothing", next == 0 ? "ok" : "failed");
+  return !exceeded || strcmp(exceeded, expected) != 0 || next != 0;
+}
+
+int main(void) {
+  if (!mkdtemp(dir)) {
+    perror(dir);
+    return 1;
+  }
+  int failures = 0;
+
+  failures += check_limit("loop",
+                          "function Main()\n"
+                          "  while true do end\n"
+                          "end\n",
+                          &(LuaLimits){.timeout_ms = 100}, "time limit");
+
+  failures += check_limit("alloc_bomb",
+                          "function Main()\n"
+                          "  local t = {}\n"
+                          "  for i = 1, 1e8 do t[i] = {i} end\n"
+                          "end\n",
+                          &(LuaLimits){.max_memory_kb = 8192}, "memory limit");
+
+  failures += check_limit("instructions",
+                          "function Main()\n"
+                          "  local n = 0\n"
+                          "  for i = 1, 1e9 do n = n + i end\n"
+                          "  return n\n"
+                          "end\n",
+                          &(LuaLimits){.max_instructions = 100000},
+                          "instruction limit");
+
+  // Reading the kept table after its Main returned must raise instead of
+  // touching the freed image.
+  const char *kept = write_script("kept_image", kept_image);
+  LuaLimits none = {0};
+  int first = generate(kept, &none);
+  int second = generate(kept, &none);
+  int next = generate(write_script("well_behaved", well_behaved), &none);
+  printf("%-12s first run %s, reuse %s, next run %s\n", "kept_image",
+         first == 0 ? "ok" : "failed", second == 0 ? "allowed" : "refused",
+         next == 0 ? "ok" : "failed");
+  failures += first != 0 || second == 0 || next != 0;
+
+  lua_vm_close();
+  static const char *scripts[] = {"loop", "alloc_bomb", "instructions",
+                                  "kept_image", "well_behaved"};
+  for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++)
+    unlink(write_script(scripts[i], ""));
+  rmdir(dir);
+  return failures ? 1 : 0;
+}
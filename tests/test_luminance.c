@@ -0,0 +1,95 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Regression test for solve_luminance against the binary search it replaced
+// in ensure_contrast: over a grid of hues, saturations and targets, its
+// result must never be further from the target luminance, and it must be
+// faster.
+
+#include "color/color_conversion.h"
+#include "color/color_operation.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define REFERENCE_ITERATIONS 10
+#define TIMING_CALLS 2000000
+
+// binary_luminance_adjust as ensure_contrast called it, with s_min == s_max
+static Color reference_adjust(float luminance_desired, float hue, float s,
+                              float v_min, float v_max) {
+  HSV result = {hue, s, (v_min + v_max) / 2};
+
+  for (int i = 0; i < REFERENCE_ITERATIONS; i++) {
+    result.v = (v_min + v_max) / 2.0f;
+    float current_lum = w3_luminance(hsv_to_rgb(result));
+    if (current_lum >= luminance_desired)
+      v_max = result.v;
+    else
+      v_min = result.v;
+  }
+
+  result.v = (v_min + v_max) / 2.0f;
+  return hsv_to_rgb(result);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  long checked = 0, worse = 0, better = 0;
+  float worst = 0.0f;
+
+  for (int h = 0; h < 360; h++) {
+    for (int si = 0; si <= 40; si++) {
+      for (int ti = 0; ti <= 400; ti++) {
+        float s = si / 40.0f, target = ti / 400.0f;
+        Color solved = solve_luminance(target, (float)h, s);
+        Color reference = reference_adjust(target, (float)h, s, 0.0f, 1.0f);
+        float error = fabsf(w3_luminance(solved) - target);
+        float reference_error = fabsf(w3_luminance(reference) - target);
+        checked++;
+        if (error > reference_error) {
+          worse++;
+          if (error - reference_error > worst)
+            worst = error - reference_error;
+          if (worse <= 5)
+            fprintf(stderr, "h %d s %g target %g: error %g, was %g\n", h, s,
+                    target, error, reference_error);
+        } else if (error < reference_error) {
+          better++;
+        }
+      }
+    }
+  }
+  printf("%ld targets: %ld closer than before, %ld further (by up to %g)\n",
+         checked, better, worse, worst);
+
+  volatile unsigned sink = 0;
+  double start = now();
+  for (int i = 0; i < TIMING_CALLS; i++)
+    sink += reference_adjust((i % 397) / 397.0f, i % 360, 0.5f, 0.0f, 1.0f).red;
+  double reference_time = now() - start;
+  start = now();
+  for (int i = 0; i < TIMING_CALLS; i++)
+    sink += solve_luminance((i % 397) / 397.0f, i % 360, 0.5f).red;
+  double solve_time = now() - start;
+  printf("%.1f M/s binary search, %.1f M/s solve_luminance\n",
+         TIMING_CALLS / reference_time / 1e6, TIMING_CALLS / solve_time / 1e6);
+
+  if (worse) {
+    fprintf(stderr, "FAIL: solve_luminance is less accurate than before\n");
+    return 1;
+  }
+  return 0;
+}
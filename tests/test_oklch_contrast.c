@@ -0,0 +1,57 @@
+/*
+ *  cwal: Blazing-fast pywal-like color palette generator written in C.
+ *  Copyright (c) 2026 Nitin Bhat <nitinbhat972@gmail.com>
+ *  Repository: https://github.com/nitinbhat972/cwal
+ *
+ *  Licensed under the GNU General Public License v3.0.
+ *  If you find this code useful, please consider giving it a star on GitHub!
+ *  Any contributions or forks must retain this original header.
+ */
+
+// Runs the OKLCH engine over random palettes with a contrast setting and
+// checks every color 1..14 of the written palette against its background:
+// the WCAG ratio, measured on the bytes, must reach the mode's minimum.
+
+#include "color/color_operation.h"
+#include "color/colors.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PALETTES 20000
+#define MIN_RATIO_LIGHT 4.5f // MIN_CONTRAST_RATIO_LIGHT in colors.c
+#define MIN_RATIO_DARK 5.5f  // MIN_CONTRAST_RATIO_DARK
+
+int main(void) {
+  static const float contrasts[] = {1.5f, 3.0f, 4.5f};
+  long checked = 0, below = 0;
+  float worst[2] = {100.0f, 100.0f};
+
+  srand(1);
+  for (int p = 0; p < PALETTES; p++) {
+    Palette palette = {0};
+    for (int i = 0; i < PALETTE_MAX_SIZE; i++)
+      palette.colors[i] = (Color){rand() & 255, rand() & 255, rand() & 255};
+    palette.engine = ENGINE_OKLCH;
+    palette.mode = p & 1 ? LIGHT : DARK;
+    palette.cols16_mode = p & 2 ? LIGHTEN : DARKEN;
+    palette.contrast = contrasts[p % 3];
+    palette.saturation = (p % 5) * 0.1f - 0.2f;
+    process_colors(&palette);
+
+    bool light = palette.mode == LIGHT;
+    float target = light ? MIN_RATIO_LIGHT : MIN_RATIO_DARK;
+    for (int i = 1; i < 15; i++) {
+      float ratio = contrast_ratio(palette.colors[i], palette.colors[0]);
+      if (ratio < target && below++ < 10)
+        fprintf(stderr, "palette %d color %d: ratio %.3f < %.1f\n", p, i,
+                ratio, target);
+      if (ratio < worst[light])
+        worst[light] = ratio;
+      checked++;
+    }
+  }
+
+  printf("%ld of %ld colors below the minimum; worst %.3f dark, %.3f light\n",
+         below, checked, worst[0], worst[1]);
+  return below ? 1 : 0;
+}